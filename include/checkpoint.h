@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECKPOINT_MAGIC    "UNICKPT"
+#define CHECKPOINT_VERSION  1
+
+/*
+ * Snapshot of the built-in trainer.
+ * File layout:
+ *   CheckpointHeader
+ *   `iterNum` x `blockNum` bytes, 1 for the corpus blocks trained
+ *   vertex table, then context table, (vertexNum + 1) rows of `rowBytes`
+ **/
+struct CheckpointHeader {
+    char        magic[8];
+    int32_t     version;
+    int32_t     precision;
+    int64_t     vertexNum;
+    int64_t     dim;
+    int64_t     rowBytes;
+    int64_t     blockNum;   /* of the corpus trained on */
+    int64_t     iterNum;
+    uint64_t    step;       /* walks trained, drives the learning rate */
+    uint64_t    pairs;
+};
+
+/*
+ * Snapshots are written by a background thread from the live tables while
+ * training goes on, so a snapshot mixes rows from before and after some
+ * updates, which lock free training tolerates anyway. Only blocks done
+ * when the snapshot starts are recorded as such. Each snapshot goes to a
+ * temporary file renamed over the previous one once complete.
+ **/
+class Checkpoint {
+public:
+    Checkpoint(const char *_path);
+    ~Checkpoint();
+
+    /*
+     * Header and progress of an existing checkpoint, tables read into
+     * `vtx` and `ctx` once `expected` matches in every field but the
+     * progress. False if there is none, exits if it does not match.
+     **/
+    bool load(const CheckpointHeader &expected, CheckpointHeader &header,
+              std::vector<unsigned char> &done, char *vtx, char *ctx);
+
+    /* false while the previous snapshot is still being written */
+    bool start(const CheckpointHeader &header, const std::atomic<unsigned char> *done,
+               const char *vtx, const char *ctx);
+    void wait();
+private:
+    std::string         path;
+    std::thread         writer;
+    std::atomic<bool>   busy;
+
+    void write(CheckpointHeader header, std::vector<unsigned char> done,
+               const char *vtx, const char *ctx);
+};
+
+void initCheckpointHeader(CheckpointHeader &header);
+
+#endif // CHECKPOINT_H
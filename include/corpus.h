@@ -0,0 +1,200 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "kgraph.h"
+#include "walkio.h"
+
+#include <stdint.h>
+#include <vector>
+
+#define CORPUS_MAGIC    "UNIWALK"
+#define CORPUS_VERSION  1
+
+/* How vertex ids are stored inside a walk */
+enum CorpusEncoding {
+    CORPUS_DELTA = 1,   /* zig-zag varint of the difference to the previous vertex */
+    CORPUS_RANK  = 2    /* varint of the vertex rank in descending degree order */
+};
+
+/*
+ * Compact walk corpus.
+ * File layout:
+ *   CorpusHeader
+ *   rank table, `vertexNum` ints mapping rank to vertex (CORPUS_RANK only)
+ *   blocks, each holding whole walks as a varint length followed by the
+ *   encoded vertices
+ *   block index, `blockNum` CorpusBlockEntry starting at `indexOffset`
+ **/
+struct CorpusHeader {
+    char        magic[8];
+    int32_t     version;
+    int32_t     encoding;
+    int64_t     vertexNum;
+    int64_t     walkNum;
+    int64_t     blockNum;
+    int64_t     indexOffset;
+    int64_t     rankOffset;
+    int32_t     walkLength;
+    int32_t     maxBlockInts;   /* decoded size of the largest block, lengths included */
+    int32_t     model;
+    float       paramP;
+    float       paramQ;
+    char        meta[36];
+};
+
+struct CorpusBlockEntry {
+    int64_t     offset;
+    int64_t     firstWalk;
+    int32_t     walkNum;
+    int32_t     bytes;
+};
+
+/*
+ * Varint walk encoder and decoder shared by the writer and the reader.
+ **/
+class CorpusCodec {
+public:
+    CorpusCodec(CorpusEncoding _encoding, VertexIndexType _vertexNum);
+    ~CorpusCodec();
+
+    /* degree order used by CORPUS_RANK */
+    void buildRank(int *degrees);
+    void loadRank(FILE *file, int64_t offset);
+    VertexIndexType *getRankTable() { return rankToVertex; }
+    /* grow to `_vertexNum` vertices, new ones ranked after the existing ones */
+    void extend(VertexIndexType _vertexNum);
+
+    /* upper bound of the bytes needed for a walk */
+    static int maxBytes(int length) { return 5 * (length + 1); }
+
+    /* returns the number of bytes written to `out` */
+    int encodeWalk(const int *walk, int length, unsigned char *out);
+
+    /* decode `walkNum` walks into the length prefixed layout of WalkBlock */
+    bool decodeBlock(const unsigned char *in, int bytes, int walkNum, WalkBlock *block);
+
+    CorpusEncoding getEncoding() { return encoding; }
+    VertexIndexType getVertexNum() { return vertexNum; }
+private:
+    CorpusEncoding  encoding;
+    VertexIndexType vertexNum;
+    VertexIndexType *vertexToRank;
+    VertexIndexType *rankToVertex;
+};
+
+/*
+ * Appends encoded blocks to a corpus file and writes the block index and the
+ * final header on close. Threads append concurrently at atomically reserved
+ * offsets, each one keeping the index entries of its own blocks.
+ * `data` must be a ParallelFileWriter buffer when direct I/O is enabled.
+ **/
+class CorpusWriter {
+public:
+    CorpusWriter(const char *path, CorpusHeader &_header, CorpusCodec *_codec,
+                 int _threadNum, bool direct);
+    ~CorpusWriter();
+    void appendBlock(int tid, unsigned char *data, int bytes, int walkNum, int ints);
+    void close();
+private:
+    ParallelFileWriter  *file;
+    CorpusHeader        header;
+    CorpusCodec         *codec;
+    int                 threadNum;
+    std::vector<CorpusBlockEntry> *index;
+    int                 *maxBlockInts;
+};
+
+/*
+ * Random access reader, blocks can be decoded concurrently.
+ **/
+class CorpusReader {
+public:
+    CorpusReader(const char *path);
+    ~CorpusReader();
+
+    bool isOpen() { return fd >= 0; }
+    CorpusHeader &getHeader() { return header; }
+    int64_t getBlockNum() { return header.blockNum; }
+    CorpusBlockEntry &getBlockEntry(int64_t idx) { return index[idx]; }
+    CorpusCodec *getCodec() { return codec; }
+
+    /* a block large enough for any block of this corpus */
+    WalkBlock *newBlock() { return new WalkBlock(header.maxBlockInts); }
+
+    /* `buffer` is caller owned scratch space, grown when needed */
+    bool readBlock(int64_t idx, WalkBlock *block, std::vector<unsigned char> &buffer);
+
+    /* raw encoded bytes of a block */
+    bool readRaw(int64_t idx, std::vector<unsigned char> &buffer);
+    bool readRaw(int64_t idx, unsigned char *buffer);
+private:
+    int             fd;
+    CorpusHeader    header;
+    CorpusCodec     *codec;
+    std::vector<CorpusBlockEntry> index;
+};
+
+/*
+ * Walk output encoding every thread's walks into its own block buffer.
+ **/
+class CorpusWalkOutput : public WalkOutput {
+public:
+    CorpusWalkOutput(const char *path, CorpusHeader &header, LSGraph *graph,
+                     int _threadNum, bool direct);
+    /* encode with the vertex order of an existing corpus, `_codec` is not owned */
+    CorpusWalkOutput(const char *path, CorpusHeader &header, CorpusCodec *_codec,
+                     int _threadNum, bool direct);
+    ~CorpusWalkOutput();
+    void write(int tid, const int *walk, int length);
+    /* append an already encoded block as is */
+    void copyBlock(int tid, unsigned char *data, int bytes, int walkNum, int ints);
+    void close();
+
+    static const int blockBytes = 1 << 20;
+private:
+    struct Buffer {
+        unsigned char   *data;
+        int             bytes;
+        int             walkNum;
+        int             ints;
+    };
+    int             threadNum;
+    Buffer          *buffers;
+    CorpusCodec     *codec;
+    bool            ownCodec;
+    CorpusWriter    *writer;
+
+    void init(const char *path, CorpusHeader &header, bool direct);
+    void flush(int tid);
+};
+
+void initCorpusHeader(CorpusHeader &header, CorpusEncoding encoding, VertexIndexType vertexNum);
+
+/* Whether `path` holds a corpus whose writer finished */
+bool corpusComplete(const char *path);
+
+#endif // CORPUS_H
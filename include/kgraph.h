@@ -29,6 +29,7 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 #include "utils.h"
 
@@ -37,11 +38,37 @@ using namespace std;
 typedef long long   EdgeIndexType;
 typedef int         VertexIndexType;
 typedef float       WeightType;
+typedef int         TimeType;
+
+/* One edge change of a graph update, applied to both directions */
+struct EdgeUpdate {
+    VertexIndexType src;
+    VertexIndexType dst;
+    WeightType      weight;
+    bool            insert;
+};
+
+/*
+ * Read an edge update file, one edge per line:
+ *   + u v [w]   insert, or update the weight of an existing edge
+ *   - u v       delete
+ *   u v [w]     insert
+ * Returns false if the file cannot be opened.
+ **/
+bool readEdgeUpdates(const char *path, std::vector<EdgeUpdate> &updates);
 
 /** 
  * large scale graph
  * The graph storage model should be updated, in order to store large scale labeled weighted graphs.
  * Here we assume node has types, edge has types and weights.
+ *
+ * The neighbors of `v` are edges[offsets[v] .. offsets[v] + degrees[v]),
+ * sorted by id. Once slack is reserved, offsets[v + 1] - offsets[v] may be
+ * larger than the degree, which leaves room for edge insertions in place.
+ * Once partitioned by type, neighbors are sorted by (type, id) and the
+ * neighbors of each type form a contiguous range.
+ * Temporal graphs store a timestamp per edge and sort neighbors by
+ * (time, id) instead, so a neighbor may appear once per timestamp.
  **/
 
 class LSGraph {
@@ -51,25 +78,46 @@ private:
     VertexIndexType *degrees;
     VertexIndexType *node_types;
     float *weights;
+    TimeType        *times;
 
     bool            tossWeight;
     bool            tossReverse;
     
     bool            hetro;
+    bool            temporal;
     VertexIndexType nv;
     EdgeIndexType   ne;
     VertexIndexType type_num;
     EdgeIndexType   *edges_r;
+
+    /* spare slots per vertex, as a fraction of its degree */
+    float           slack;
+
+    /* per vertex start of each type range, relative to offsets[v] */
+    bool            typeSorted;
+    VertexIndexType maxType;
+    VertexIndexType *typeOffsets;
+
+    void countTypeRanges(VertexIndexType v);
+    void sortByTime();
+    EdgeIndexType findTemporalEdge(VertexIndexType src, VertexIndexType dst, TimeType time);
+
+    EdgeIndexType slackFor(VertexIndexType degree);
+    void relayout(const VertexIndexType *minDegrees);
+    VertexIndexType mergeAdjacency(VertexIndexType v, const EdgeUpdate *begin,
+        const EdgeUpdate *end, VertexIndexType *outEdges, WeightType *outWeights);
     
 public:
     bool weighted; 
-    LSGraph(){};
+    LSGraph() { slack = 0; typeSorted = false; typeOffsets = nullptr; temporal = false; times = nullptr; };
     ~LSGraph() {
         free(this->offsets);
         free(this->edges);
         free(this->degrees);
         free(this->weights);
         free(this->edges_r);
+        free(this->typeOffsets);
+        free(this->times);
     }
     bool loadCRSGraph(string network_file);
     bool loadCRSGraph(int argc, char **argv);
@@ -78,6 +126,51 @@ public:
     
     void init_reverse();
 
+    bool isTemporal() { return temporal; }
+    TimeType *getTimes() { return times; }
+
+    /*
+     * first neighbor of `v` with a timestamp after `time`, as an offset
+     * from offsets[v], temporal graphs only
+     **/
+    VertexIndexType laterThan(VertexIndexType v, TimeType time) {
+        TimeType *begin = times + offsets[v];
+        return std::upper_bound(begin, begin + degrees[v], time) - begin;
+    }
+
+    /* order of neighbors inside a vertex's range */
+    bool neighborLess(VertexIndexType a, VertexIndexType b) {
+        if (typeSorted && node_types[a] != node_types[b])
+            return node_types[a] < node_types[b];
+        return a < b;
+    }
+
+    /* sort neighbors by type, a no-op when already partitioned */
+    void partitionByType();
+    bool isTypeSorted() { return typeSorted; }
+    VertexIndexType getMaxType() { return maxType; }
+
+    /* neighbors of `v` having type `type`, partitioned graphs only */
+    void typeRange(VertexIndexType v, int type, EdgeIndexType &begin, VertexIndexType &count) {
+        begin = offsets[v];
+        count = 0;
+        if (type < 0 || type > maxType) return;
+        VertexIndexType *range = typeOffsets + (EdgeIndexType)v * (maxType + 2);
+        begin += range[type];
+        count = range[type + 1] - range[type];
+    }
+
+    /* spread the edges so every vertex gets `ratio * degree` spare slots */
+    void reserveSlack(float ratio);
+
+    /*
+     * Apply a batch of edge updates. Must not run concurrently with walkers.
+     * `touched` receives the vertices whose adjacency changed. Returns true if
+     * the edge array had to be laid out again, which moves every edge index.
+     **/
+    bool applyEdgeBatch(const EdgeUpdate *updates, EdgeIndexType num,
+                        std::vector<VertexIndexType> &touched);
+
     EdgeIndexType find_edge(int src, int dst);
 
     int has_edge(int from, int to);
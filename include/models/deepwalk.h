@@ -28,12 +28,26 @@
 #include "rwmodel.h"
 class DeepWalk : RWModel {
 public:
-    DeepWalk(LSGraph *_graph);
+    DeepWalk(LSGraph *_graph, int argc, char **argv);
     float computeWeight(State curState, EdgeIndexType nextEdgeIndex);
     State newState(State curState, EdgeIndexType nextEdgeIndex);
     State getInitialState(VertexIndexType initialVertex);
     int stateNum(VertexIndexType vertex);
     float maxWeight();
+    EdgeIndexType proposeEdge(
+        State curState, EdgeIndexType begin, VertexIndexType count, myrandom &random);
+    void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid);
+protected:
+    /*
+     * On weighted graphs every vertex gets an alias table over its neighbor
+     * weights, laid out like the edge array. Proposals then follow the
+     * weights exactly and every one of them is accepted.
+     **/
+    float           *aliasProb;
+    VertexIndexType *aliasIndex;
+
+    void buildAlias();
+    void buildAlias(VertexIndexType vertex);
 };
 
 #endif
\ No newline at end of file
@@ -26,23 +26,35 @@
 #include "math.h"
 #include "assert.h"
 
+#include <omp.h>
+#include <atomic>
+
 class Edge2vec : RWModel {
 public:
     Edge2vec(LSGraph *_graph, int argc, char **argv);
+    ~Edge2vec();
     float computeWeight(State curState, long long nextEdgeIndex);
     State newState(State curState, long long nextEdgeIndex);
     State getInitialState(int initialVertex);
+    State resumeState(const int *walk, int pos);
     int stateNum(int vertex);
 
     void handleWalk(int *walkSeq, int length);
 
     void handleIter();
 
+    void initThreads(int threadNum);
+
     int getIter();
+
+    void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid);
 private:
     void init();
+    void setGraph();
     int edgeType(int v1, int v2);
     std::pair<int, int> nodeType(int edge);
+    void collectTypes(const VertexIndexType *vertices, long long n);
+    void growTypes(int newNum);
 
     int iterNum;
     float param_p;
@@ -58,8 +70,80 @@ private:
 
     int type_num;
     int edge_type_num;
-    float **matM;
-    int **typeCount;
+
+    /*
+     * Matrix M, edge_type_num x edge_type_num in row major order. A refresh
+     * builds the next version aside and swaps the pointer, so walkers never
+     * see a half written matrix. A replaced version may still be read by a
+     * walker; it is kept in retired with the epoch that replaced it, and
+     * freed once every thread has finished a walk in that epoch or later.
+     * A thread holds no version between walks, so handleWalk publishes
+     * the epoch it has seen in seenEpoch.
+     **/
+    std::atomic<float *> matM;
+    std::vector<std::pair<float *, long long>> retired;
+    std::atomic<long long> epoch;
+    std::atomic<long long> *seenEpoch;
+
+    /*
+     * With -async the walks of a single sweep refresh M every refreshWalks
+     * walks from the statistics streamed so far, instead of getIter sweeps
+     * separated by handleIter.
+     **/
+    bool async;
+    long long refreshWalks;
+    std::atomic<long long> walkCount;
+    std::atomic<bool> refreshing;
+
+    /*
+     * Totals the walkers of the async mode add their statistics to every
+     * flushWalks walks, so a refresh never reads another thread's
+     * TypeStats. There are two sets: walkers flush into the active one,
+     * and a refresh switches sets, waits for the flushes still going into
+     * the old one (flushing counts them) and then reads and clears it. Every
+     * M is thus computed from a consistent set of the walks since the
+     * previous one, like an iteration of the default mode.
+     **/
+    struct SharedStats {
+        std::atomic<long long>  walkNum;
+        std::atomic<long long>  *sum;
+        std::atomic<long long>  *squareSum;
+        std::atomic<long long>  *crossSum;
+    };
+    SharedStats shared[2];
+    std::atomic<int> activeSet;
+    std::atomic<int> flushing[2];
+    int flushWalks;
+
+    /*
+     * Only the node type pairs that occur on some edge get an edge type.
+     * typeIndex maps (type1 - 1) * type_num + type2 - 1 onto the compact
+     * edge type, or -1, and typePairs maps it back.
+     **/
+    int *typeIndex;
+    std::vector<int> typePairs;
+
+    /*
+     * Edge type counts of the walks of one thread, accumulated online.
+     * crossSum holds the lower triangle, entry (i, j) for j <= i at
+     * i * (i + 1) / 2 + j.
+     **/
+    struct TypeStats {
+        long long   walkNum;
+        long long   *sum;
+        long long   *squareSum;
+        long long   *crossSum;
+        int         *count;     /* scratch for the current walk */
+        int         *touched;   /* edge types with a nonzero count */
+    };
+    TypeStats *stats;
+    int threadNum;
+
+    void freeStats();
+    void flushStats(TypeStats &s);
+    void refreshMatrix();
+    void publishMatrix(float *next);
+    void reclaimMatrices(bool all);
     myrandom random = myrandom(time(0));
 
     void getArgs(int argc, char **argv);
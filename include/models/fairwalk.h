@@ -31,11 +31,15 @@ public:
     float computeWeight(State curState, long long nextEdgeIndex);
     State newState(State curState, long long nextEdgeIndex);
     State getInitialState(int initialVertex);
+    State resumeState(const int *walk, int pos);
     int stateNum(int vertex);
+    EdgeIndexType proposeEdge(State curState, EdgeIndexType begin, VertexIndexType count,
+                              myrandom &random);
+
+    void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid);
 private:
     void init();
-
-    int **neighborAttr;
+    void setGraph();
 
     int *edges;
     int *node_types;
@@ -26,6 +26,13 @@
 
 #include <string>
 
+/*
+ * Metapath guided walks over one or more circular metapaths, `-meta 1231,242`.
+ * A metapath with n types has n - 1 positions, the positions of all
+ * metapaths are numbered together. The state of a vertex is a slot among the
+ * positions having its type, so a vertex only gets samplers for positions it
+ * can actually be at.
+ **/
 class Metapath2vec : RWModel {
 public:
     Metapath2vec(LSGraph *_graph, int argc, char **argv);
@@ -33,15 +40,29 @@ public:
     float computeWeight(State curState, long long nextEdgeIndex);
     State newState(State curState, long long nextEdgeIndex);
     State getInitialState(int initialVertex);
+    State resumeState(const int *walk, int pos);
     int stateNum(int vertex);
+    void candidateRange(State curState, EdgeIndexType &begin, VertexIndexType &count);
+
+    int getPositionNum() { return this->positionNum; }
+    int *getPositionTypes() { return this->positionType; }
 
-    int getLength() { return this->length; }
-    int *getMetapath() { return this->metapath; }
+    void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) { this->init(); }
 private:
     void init();
 
-    int length;
-    int *metapath;
+    /* transition tables, indexed by position */
+    int positionNum;
+    int *positionType;
+    int *nextPosition;
+    int *prevPosition;
+    int *nextType;
+    int *nextSlot;
+
+    /* positions of type t are typePositions[slotBegin[t] .. slotBegin[t + 1]) */
+    int maxType;
+    int *slotBegin;
+    int *typePositions;
 
     int *edges;
     int *node_types;
@@ -49,9 +70,16 @@ private:
     float *weights;
 
     std::string metaString;
-    int metaLength;
+
+    int position(State state) {
+        return typePositions[slotBegin[node_types[state.first]] + state.second];
+    }
+    int slotNum(int type) {
+        return type > maxType ? 0 : slotBegin[type + 1] - slotBegin[type];
+    }
 
     void parseMeta();
+    void buildTables(std::vector<std::vector<int>> &metapaths);
 
     void getArgs(int argc, char **argv);
-};
\ No newline at end of file
+};
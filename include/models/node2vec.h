@@ -34,8 +34,10 @@ public:
     float computeWeight(State curState, long long nextEdgeIndex);
     State newState(State curState, long long nextEdgeIndex);
     State getInitialState(int initialVertex);
+    State resumeState(const int *walk, int pos);
     int stateNum(int vertex);
     float maxWeight();
+    void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid);
 private:
     float paramP;
     float paramQ;
@@ -50,11 +52,25 @@ private:
     long long *edges_r;
     float max_weight;
 
+    /*
+     * Triangle bitsets of the vertices of degree at most triThreshold.
+     * For such a vertex v, the row of its j-th neighbor u starts at
+     * triBits + triOffset[v] + j * words, words = ceil(degree(v) / 64), and
+     * bit k is set if the k-th neighbor of v is adjacent to u. triOffset is
+     * -1 for the other vertices, which fall back to has_edge.
+     **/
+    int triThreshold;
+    long long *triOffset;
+    uint64_t *triBits;
+
     myrandom random = myrandom(time(0));
     
 
     void init();
+    void setGraph();
     void getArgs(int argc, char **argv);
+    void buildTriangles();
+    int adjacent(State curState, int src, long long nextEdgeIndex);
 };
 
 #endif
\ No newline at end of file
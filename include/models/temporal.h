@@ -0,0 +1,52 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef TEMPORAL_H
+#define TEMPORAL_H
+
+#include "rwmodel.h"
+
+/*
+ * Time respecting walks over a temporal graph (-temporal), every edge taken
+ * being later than the previous one. The state keeps the first neighbor
+ * of the current vertex that is still reachable, neighbors being sorted by
+ * time, so the candidates are the suffix of the neighbor list from there.
+ **/
+class TemporalWalk : RWModel {
+public:
+    TemporalWalk(LSGraph *_graph, int argc, char **argv);
+    float computeWeight(State curState, EdgeIndexType nextEdgeIndex);
+    State newState(State curState, EdgeIndexType nextEdgeIndex);
+    State getInitialState(int initialVertex);
+    int stateNum(int vertex);
+    void candidateRange(State curState, EdgeIndexType &begin, VertexIndexType &count);
+private:
+    EdgeIndexType   *offsets;
+    VertexIndexType *edges;
+    VertexIndexType *degrees;
+    WeightType      *weights;
+    TimeType        *times;
+};
+
+#endif
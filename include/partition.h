@@ -0,0 +1,124 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+ * Partitions of the out-of-core trainer. Vertices are spread over them at
+ * random, as ranges of ids tend to be communities that would keep the
+ * negatives of a partition among related vertices. Tables store the rows
+ * of a partition together: vertex v lives in row `slot[v]` and partition
+ * p holds rows [p * partSize, (p + 1) * partSize).
+ **/
+struct Partitioning {
+    int         partNum;
+    long long   partSize;
+    std::vector<int> slot;      /* row of every vertex */
+    std::vector<int> vertex;    /* vertex of every row */
+
+    void assign(int vertexNum, int _partNum);
+    int partOf(long long row) const { return static_cast<int>(row / partSize); }
+    long long begin(int part) const { return part * partSize; }
+};
+
+/*
+ * Embedding table backed by an unlinked file in the swap directory and
+ * mapped in whole. Only the partitions being trained need to be resident:
+ * `load` reads one ahead, `evict` drops its pages, the kernel writing
+ * the dirty ones back to the file.
+ **/
+class SwapTable {
+public:
+    SwapTable(const char *dir, long long rows, long long _rowBytes, long long _partRows);
+    ~SwapTable();
+
+    char *data() { return base; }
+    void load(int part);
+    void evict(int part);
+private:
+    char            *base;
+    long long       bytes;
+    long long       rowBytes;
+    long long       partRows;
+
+    void advise(int part, int advice);
+};
+
+/*
+ * Walk pairs bucketed by (center partition, context partition), one
+ * unlinked file per bucket. A record is a center, a count and that many
+ * contexts; the contexts of a window that fall into one partition share
+ * a record so they train as a batch.
+ **/
+class PairBuckets {
+public:
+    PairBuckets(const char *dir, int _partNum);
+    ~PairBuckets();
+
+    int bucketOf(int centerPart, int contextPart) { return centerPart * partNum + contextPart; }
+
+    /* per-thread record buffers, flushed to the bucket files when full */
+    class Writer {
+    public:
+        Writer(PairBuckets *_owner);
+        ~Writer();
+        void append(int bucket, int center, const int *contexts, int count);
+        void flush();
+    private:
+        PairBuckets     *owner;
+        std::vector<std::vector<int> > buffers;
+        void flush(int bucket);
+    };
+
+    /*
+     * Whole records of a bucket, read sequentially in chunks. `next`
+     * returns false once the records up to `limit` ints into the bucket
+     * are read; `rewind` starts over.
+     **/
+    void rewind(int bucket);
+    bool next(int bucket, long long limit, std::vector<int> &chunk);
+
+    /* ints written to the bucket, flushed writers only */
+    long long size(int bucket);
+
+    long long getPairs() { return pairs; }
+
+    static const int chunkInts = 1 << 20;
+    static const int flushInts = 1 << 12;
+private:
+    int                 partNum;
+    std::vector<FILE *> files;
+    std::mutex          *locks;
+    std::atomic<long long> pairs;
+    std::vector<long long> offset;   /* ints read from each bucket */
+    std::vector<std::vector<int> > carry;   /* partial records left over by `next` */
+};
+
+#endif // PARTITION_H
@@ -0,0 +1,64 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef REWALK_H
+#define REWALK_H
+
+#include "corpus.h"
+
+#include <stdint.h>
+
+/*
+ * Edge delta of a graph update, in the format of `readEdgeUpdates`.
+ * Both endpoints of every changed edge are marked in `affected`, which holds
+ * `vertexNum` flags. Returns the number of edges read.
+ **/
+int64_t loadEdgeDelta(const char *path, VertexIndexType vertexNum, char *affected);
+
+/*
+ * Inverted index from vertices to the corpus blocks whose walks visit them,
+ * stored as CSR. It is built with one parallel decoding pass over the corpus.
+ **/
+class CorpusVertexIndex {
+public:
+    CorpusVertexIndex(CorpusReader *reader, VertexIndexType _vertexNum, int threadNum);
+    ~CorpusVertexIndex();
+
+    /* blocks visiting `vertex` */
+    const int64_t *begin(VertexIndexType vertex) { return blocks + offsets[vertex]; }
+    const int64_t *end(VertexIndexType vertex) { return blocks + offsets[vertex + 1]; }
+
+    /* decoded size of a block, lengths included */
+    int getBlockInts(int64_t block) { return blockInts[block]; }
+
+    size_t memoryBytes();
+private:
+    VertexIndexType vertexNum;
+    int64_t         blockNum;
+    int64_t         *offsets;
+    int64_t         *blocks;
+    int             *blockInts;
+};
+
+#endif // REWALK_H
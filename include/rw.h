@@ -30,7 +30,11 @@
 #include "models/metapath.h"
 #include "models/fairwalk.h"
 #include "models/edge2vec.h"
+#include "models/ppr.h"
+#include "models/temporal.h"
 #include "walker.h"
+#include "corpus.h"
+#include "rewalk.h"
 
 #include <omp.h>
 #include <chrono>
@@ -41,16 +45,19 @@ enum ModelType {
     NODE2VEC,
     METAPATH,
     FAIRWALK,
-    EDGE2VEC
+    EDGE2VEC,
+    PPR,
+    TEMPORAL
 };
 
 class RandomWalk {
 public:
-    RandomWalk(LSGraph *_graph, int argc, char **argv);
+    RandomWalk(LSGraph *_graph, int argc, char **argv, WalkQueue *_queue = nullptr);
 private:
     LSGraph *graph;
     ModelType type;
     int nodeWNum;
+    int walkLength;     /* -length, 0 keeps the default of the model */
     long long walkNum;
     int argc;
     char **argv;
@@ -58,13 +65,42 @@ private:
     int threadNum;
     StartMode startMode;
 
+    /* walks are streamed to the trainer when set */
+    WalkQueue *queue;
+
+    /* compact walk corpus output */
+    char *corpusPath;
+    CorpusEncoding encoding;
+
+    /* incremental mode, previous corpus and the edge delta since then */
+    char *prevCorpusPath;
+    char *deltaPath;
+
+    /* edge updates applied between walk rounds */
+    char *updatePath;
+    std::vector<EdgeUpdate> updates;
+    EdgeIndexType updateBatch;
+    float slack;
+
+    /* text walk trace, `txt/all` by default */
+    char *walkPath;
+    bool directIO;
+
     SamplerManager *samplerManager;
 
     RWModel *init();
 
     void runModel(RWModel *model);
 
+    void runIncremental(RWModel *model);
+
+    State startState(RWModel *model, VertexIndexType vertex, myrandom &random);
+
+    void applyUpdates(RWModel *model, EdgeIndexType &applied, EdgeIndexType batch);
+
     void getArgs(int argc, char **argv);
+
+    void fillCorpusHeader(CorpusHeader &header, int walkLength);
 };
 
 #endif
\ No newline at end of file
@@ -29,8 +29,21 @@
 
 using State = std::pair<VertexIndexType, int>;
 
+/* What a walk does before its next step */
+enum WalkAction {
+    WALK_STEP,      /* move to a neighbor */
+    WALK_STOP,      /* end the walk here */
+    WALK_RESTART    /* jump back to the start vertex */
+};
+
 class RWModel {
 public:
+    virtual ~RWModel() {}
+
+    /*
+     * Dynamic weight of an edge divided by its proposal probability, up to a
+     * constant. With uniform proposals this is just the edge weight.
+     **/
     virtual float computeWeight(
         State curState, 
         EdgeIndexType nextEdgeIndex) = 0;
@@ -44,16 +57,62 @@ public:
     
     virtual int stateNum(int vertex) = 0;
 
+    /*
+     * Edges the next step may take from `curState`, as a range of the edge
+     * array. Proposals are drawn from this range only, the walk ends when it
+     * is empty.
+     **/
+    virtual void candidateRange(State curState, EdgeIndexType &begin, VertexIndexType &count) {
+        begin = graph->getOffsets()[curState.first];
+        count = graph->getDegree()[curState.first];
+    }
+
+    /* M-H proposal within the candidate range, uniform by default */
+    virtual EdgeIndexType proposeEdge(
+        State curState, EdgeIndexType begin, VertexIndexType count, myrandom &random) {
+        return begin + (EdgeIndexType)random.irand(count);
+    }
+
+    /*
+     * Called before step `step` of a walk. Walks shorter than the walk length,
+     * such as geometrically terminated ones, end on WALK_STOP; a restart
+     * records the start vertex again and continues from its initial state.
+     **/
+    virtual WalkAction nextAction(State curState, int step, myrandom &random) {
+        return WALK_STEP;
+    }
+
+    /*
+     * State of an existing walk at position `pos` (pos > 0), used to
+     * continue the walk from there. First order models only need the vertex.
+     **/
+    virtual State resumeState(const int *walk, int pos) {
+        return std::make_pair(walk[pos], 0);
+    }
+
     LSGraph *getGraph() { return this->graph; }
 
     int getWalkLength() { return this->walkLength; }
+    void setWalkLength(int length) { this->walkLength = length; }
 
     virtual float maxWeight() { return 99999.9; }
 
-    virtual void handleaIter() {}
+    /* Called between two iterations, while no walker runs */
+    virtual void handleIter() {}
 
+    /* Called from walker threads with each finished walk */
     virtual void handleWalk(int *walkSeq, int length) {}
 
+    /* Number of walker threads, `handleWalk` sees omp thread ids below it */
+    virtual void initThreads(int threadNum) {}
+
+    /*
+     * Called after a batch of edge updates while no walker runs. `touched`
+     * lists the vertices whose neighbors changed; if `relaid` is set every
+     * graph array was reallocated and every edge index moved.
+     **/
+    virtual void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) {}
+
     virtual int getIter() { return this->iteration; }
 
 protected:
@@ -66,6 +66,9 @@ public:
     /* find corresponding sampler based on the current state */
     EdgeIndexType getNextEdge(State curState, long long candidateSample, StartMode startMode, myrandom &random, bool mem);
 
+    /* drop samplers whose edges changed in a graph update */
+    void onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid);
+
     LSGraph *graph;
     static myrandom random;
     bool memWeight;
@@ -74,5 +77,9 @@ private:
 
     /* Sampler matrix */
     Sampler **samplerSet;
+
+    Sampler *allocBucket(int vertex);
+    void freeBucket(int vertex);
+    Sampler *getSampler(int vertex, int offset);
     
 };
\ No newline at end of file
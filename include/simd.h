@@ -0,0 +1,84 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+ * Kernels over embedding rows. The objects are built without -march, so
+ * every kernel is compiled for its own target and `initSimd` picks the
+ * best set the CPU supports at run time: AVX-512F, AVX2 with FMA, or
+ * plain scalar code.
+ **/
+
+typedef float (*DotKernel)(const float *a, const float *b, int n);
+
+/* y += alpha * x */
+typedef void (*AxpyKernel)(float alpha, const float *x, float *y, int n);
+
+/* x = 1 / (1 + exp(-x)) in place, saturating to 0 and 1 outside +-6 */
+typedef void (*SigmoidKernel)(float *x, int n);
+
+struct SimdKernels {
+    const char      *name;
+    DotKernel       dot;
+    AxpyKernel      axpy;
+    SigmoidKernel   sigmoid;
+};
+
+extern SimdKernels simd;
+
+/*
+ * Select the kernels, `force` being null for the best supported set or
+ * one of "scalar", "avx2" and "avx512". Returns false if the forced set
+ * is unknown or not supported, leaving the selection unchanged.
+ **/
+bool initSimd(const char *force = nullptr);
+
+/*
+ * Storage precision of embedding tables. Reduced precision rows are
+ * widened to fp32 for the arithmetic and narrowed again when stored.
+ **/
+enum Precision {
+    PRECISION_FP32,
+    PRECISION_BF16,
+    PRECISION_FP16
+};
+
+bool parsePrecision(const char *name, Precision &precision);
+const char *precisionName(Precision precision);
+int precisionBytes(Precision precision);
+
+class myrandom;
+
+/* n values stored in `precision` at src into fp32 */
+void loadRow(Precision precision, const void *src, float *dst, int n);
+
+/*
+ * n fp32 values into `precision` at dst, rounding to nearest even, or
+ * stochastically if `random` is given so small updates are not lost
+ **/
+void storeRow(Precision precision, const float *src, void *dst, int n, myrandom *random);
+
+#endif
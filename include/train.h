@@ -1,40 +1,225 @@
 #include "utils.h"
 #include "kgraph.h"
+#include "walkqueue.h"
+#include "corpus.h"
+#include "simd.h"
+#include "partition.h"
+#include "walkio.h"
+#include "checkpoint.h"
+#include "warmstart.h"
+#include "rewalk.h"
 #include <chrono>
 #include <omp.h>
 #include <iomanip>
+#include <atomic>
 
 #define VECTORIZE 1
 
 using ull = unsigned long long;
 
+/* embedding file layouts of `-format` */
+enum OutputFormat {
+    OUTPUT_TXT,     /* "<nv> <dim>" line, then "<vertex> <values>" lines */
+    OUTPUT_BIN,     /* "<nv> <dim> <precision>" line, then the rows as stored */
+    OUTPUT_NPY,     /* NumPy array of nv x dim, fp16 or fp32 */
+    OUTPUT_W2V      /* word2vec binary, "<vertex> " and dim fp32 per row */
+};
+
 class Train {
 public:
+    /* train on the walk corpus given by `-corpus` */
     Train(LSGraph *_graph, int argc, char **argv);
 
+    /* train on walks streamed by the walkers instead of walk files */
+    Train(LSGraph *_graph, int argc, char **argv, WalkQueue *_queue);
+
 private:
-    FILE *files[30];
+    WalkQueue *queue;
 
+    void run();
     void trainSG();
+    void trainStream();
     void init();
+    /*
+     * Threads format `outputRows` rows each into their buffer, the buffers
+     * are then written in order at their offsets, one write per buffer.
+     **/
     void write_file();
+    std::string outputHeader();
+    void formatRows(int first, int last, std::vector<char> &out, float *scratch);
+    long long vertexRow(int v) { return parts.partNum > 1 ? parts.slot[v] : v; }
+    static const int outputRows = 4096;
+
+    /*
+     * Rows of one window, gathered per thread. The contexts of a center
+     * share its positive and negative output rows (pSGNS), which turns the
+     * updates into small dense matrix products over these buffers.
+     **/
+    struct Batch {
+        long long   *inIdx;     /* context vertices, rows of wVtx */
+        long long   *outIdx;    /* center then negatives, rows of wCtx */
+        float       *inRows;    /* 2 * window_size rows */
+        float       *outRows;   /* negative + 1 rows */
+        float       *inGrad;
+        float       *outGrad;
+        float       *err;       /* inNum x outNum */
+        float       *hubRows;   /* this thread's replica of the hub rows of wCtx */
+        float       *hubBase;   /* the hub rows as of the last merge */
+        int         sinceSync;  /* batches trained since the last merge */
+        int         *negBuf;    /* negatives drawn ahead, used from the back */
+        int         negLeft;
+        int         negPart;    /* partition and table they were drawn from */
+        void        *negFrom;
+    };
+    Batch *newBatch();
+    void freeBatch(Batch *batch);
+    void trainBatch(Batch *batch, int inNum, int outNum, float lr, myrandom &random);
+
+    /*
+     * The top `hubNum` vertices by degree are negatives or centers of a
+     * large share of the batches. Every thread updates its own fp32 copy
+     * of their wCtx rows and every `hubSync` batches adds what it learned
+     * since the last merge to the shared rows, then copies them back.
+     * With partitions, only the hubs of the resident context partition
+     * `hubPart` are copied and merged, the others staying on disk.
+     **/
+    void initHubs();
+    void loadHubs(Batch *batch);
+    void syncHubs(Batch *batch, myrandom &random);
+    bool hubResident(int h) { return hubPart < 0 || parts.partOf(hubs[h]) == hubPart; }
+    int hubOf(long long idx) { return hubIndex != nullptr ? hubIndex[idx] : -1; }
+
+    /* add `grad` to a stored row, going through fp32 in reduced precision */
+    void addToRow(char *matrix, long long idx, const float *grad, float *scratch, myrandom &random);
+    char *row(char *matrix, long long idx) { return matrix + idx * rowBytes; }
+
+    /* skip-gram with negative sampling over a single walk */
+    void trainWalk(const int *walk, int length, float lr, Batch *batch, myrandom &random);
+
+    /*
+     * Vertex ids are word ids, so there is no vocabulary. Walks visit a
+     * vertex about as often as its degree, which stands in for the word
+     * counts: negatives are drawn from degree^0.75 and frequent vertices
+     * are subsampled by their share of the total degree.
+     **/
+    void initNegTable();
+    void initSubsample();
+
+    /*
+     * Alias tables over frequency^0.75, one per partition over its rows,
+     * a single one unless partitioned. With `-neg-source walks` the
+     * frequencies are the visits counted in the walks seen so far: the
+     * tables start from degrees and are rebuilt whenever the count has
+     * doubled, so negatives are there before the first walk.
+     **/
+    struct NegTable {
+        float   *prob;      /* per table row */
+        int     *alias;     /* slot within the partition */
+    };
+    NegTable *buildNegTable(const unsigned int *counts);
+    void freeNegTable(NegTable *table);
+    void countVisits(const int *walk, int length);
+
+    /* negatives of `part`, drawn `negBatch` at a time into the batch */
+    long long nextNegative(Batch *batch, int part, myrandom &random);
+    static const int negBatch = 1024;
+    long long partBegin(int part) { return parts.partNum > 1 ? parts.begin(part) : 0; }
+    long long partEnd(int part) {
+        return parts.partNum > 1 ? std::min(parts.begin(part + 1), (long long)nv) : nv;
+    }
 
-    inline void update( // update the embedding, putting w_t gradient in w_t_cache
-        float *w_s, float *w_t, float *w_t_cache, float lr, const int label);
+    /* copy of the walk without the vertices dropped by subsampling */
+    int subsampleWalk(const int *walk, int length, int *kept, myrandom &random);
 
-    float *wVtx;
-    float *wCtx;
+    float learningRate(ull curStep, ull totalSteps);
+
+    /*
+     * Out-of-core training with `-partitions` P > 1. The tables live in
+     * swap files, the walk pairs are first bucketed by the partitions of
+     * their center and context, then each bucket trains with only those
+     * two partitions resident. Negatives come from the center's partition.
+     **/
+    void bucketPairs();
+    void bucketWalk(const int *walk, int length, PairBuckets::Writer &writer, myrandom &random);
+    void trainBuckets();
+    void trainRecord(const int *record, float lr, Batch *batch, myrandom &random);
+    void initPartitions();
+
+    Partitioning parts;
+    int partPasses;         /* passes over the buckets per iteration */
+    char *swap_dir;
+    SwapTable *vtxTable;
+    SwapTable *ctxTable;
+    PairBuckets *buckets;
+
+    /*
+     * (nv + 1) x n_hidden tables stored in `precision`, rowBytes bytes per
+     * row; rows are widened to fp32 in the batch buffers for the arithmetic
+     **/
+    char *wVtx;
+    char *wCtx;
+    Precision precision;
+    bool stochastic;    /* stochastic rounding when storing reduced rows */
+    bool padRows;       /* rows start on a cache line of their own */
+    long long rowBytes;     /* row stride, padded or not */
+    long long dataBytes;    /* bytes of one row without padding */
     float initial_lr;
     int window_size;
+    int negative;
     int n_hidden;
     int n_walks;
-    int walk_length;
+    int n_iter;
     char *out_path;
+    OutputFormat format;
+    char *corpus_path;
+
+    /*
+     * With `-checkpoint`, corpus training snapshots the tables, the step
+     * and the blocks trained every `checkpointInterval` seconds in the
+     * background; `-resume 1` starts from the snapshot if there is one.
+     **/
+    char *checkpoint_path;
+    int checkpointInterval;
+    bool resume;
+    CheckpointHeader checkpointHeader(long long blockNum);
+
+    /*
+     * `-init-emb` starts from the tables of an earlier run instead of
+     * random rows. With `-delta`, `affected` flags the endpoints of the
+     * changed edges and the vertices new to the graph, and only walks
+     * through one of them are trained.
+     **/
+    char *init_emb_path;
+    char *delta_path;
+    char *affected;
+    void warmStart();
+    bool touchesAffected(const int *walk, int length);
+
+    char *simd_name;    /* forced kernel set, null to detect */
 
     int threadNum;
 
     int nv;
     ull step;
+    ull pairs;      /* positive (center, context) pairs trained */
+    ull resumedPairs;   /* part of `pairs` restored from a checkpoint */
+
+    LSGraph *graph;
+    std::atomic<NegTable *> negTable;
+    std::vector<NegTable *> retiredNeg;     /* replaced tables, freed after training */
+    bool negFromWalks;
+    unsigned int *visits;   /* visits of every vertex, null unless negFromWalks */
+    std::atomic<long long> visitTotal;
+    std::atomic<long long> nextRebuild;
+    std::atomic<bool> rebuilding;
+    float sample;
+    float *keepProb;    /* chance of keeping each vertex, null without subsampling */
+
+    int hubNum;
+    int hubSync;
+    long long *hubs;    /* table row of every hub */
+    int *hubIndex;      /* hub of every table row or -1, null without hubs */
+    int hubPart;        /* partition whose hubs are in use, -1 for all */
 
     void getArgs(int argc, char **argv);
     
@@ -87,4 +87,11 @@ float fast_sigmoid(double x);
 
 bool eq(float a, float b);
 
+/*
+ * Vose's alias method over `n` weights. Slot k keeps k with probability
+ * prob[k] and gives way to alias[k] otherwise; weights summing to zero
+ * give a uniform table. Shared with word2vec.c, hence the C linkage.
+ **/
+extern "C" void buildAliasTable(const float *weights, long long n, float *prob, int *alias);
+
 #endif 
\ No newline at end of file
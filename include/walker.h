@@ -28,6 +28,7 @@
 #include "rwmodel.h"
 #include "utils.h"
 #include "sampler.h"
+#include "walkio.h"
 
 #include <omp.h>
 #include <unordered_map>
@@ -41,13 +42,16 @@ public:
         int _initialVertex,
         State _initialState,
         StartMode _startMode,
-        FILE *file,
-        bool _out,
+        WalkOutput *_output,
         SamplerManager *_samplerManager,
         int _burninIter = 100
     );
      ~Walker();
     void walkerExecute();
+
+    /* generated sequence, valid after `walkerExecute` */
+    int *getWalk() { return walkSq; }
+    int getLength() { return length; }
 private:
 
     LSGraph *graph;
@@ -62,10 +66,9 @@ private:
     int initialVertex;
     int curVertex;
     int walkLength;
-    char outputPath[100];
-    FILE *fp;
+    int length;
+    WalkOutput *output;
     int *walkSq;
-    FILE *txt;
     myrandom random = myrandom(time(0) + mainrandom.irand(10000));
     StartMode startMode;
     int burninIter;
@@ -76,7 +79,6 @@ private:
     int *degrees;
 
     bool executable;
-    bool out;
 
     void init();
     void setGraph();
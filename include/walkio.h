@@ -0,0 +1,140 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef WALKIO_H
+#define WALKIO_H
+
+#include "walkqueue.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+/*
+ * Destination of generated walks.
+ * `write` is called concurrently by walker threads with their OpenMP thread
+ * id, `close` is called once after all walks are generated.
+ **/
+class WalkOutput {
+public:
+    virtual ~WalkOutput() {}
+    virtual void write(int tid, const int *walk, int length) = 0;
+    virtual void close() {}
+};
+
+/*
+ * One output file shared by all threads.
+ * Each `append` reserves its file range with an atomic add and writes it with
+ * `pwrite`, so threads never wait for each other and no merge is needed.
+ * With direct I/O every appended range is padded to `alignment` and the data
+ * must come from an aligned buffer of the padded size.
+ **/
+class ParallelFileWriter {
+public:
+    ParallelFileWriter(const char *path, bool _direct);
+    ~ParallelFileWriter();
+
+    static const size_t alignment = 4096;
+    static size_t padded(size_t bytes) { return (bytes + alignment - 1) & ~(alignment - 1); }
+    static void *allocBuffer(size_t bytes);
+
+    /* metadata written through the page cache at a fixed offset */
+    bool writeAt(int64_t offset, const void *data, size_t bytes);
+    /* reserve `bytes` at the current end of the file without writing */
+    int64_t reserve(size_t bytes);
+    /* returns the offset of the data, the padding is filled with `fill` */
+    int64_t append(void *data, size_t bytes, char fill = 0);
+
+    int64_t getEnd() { return end.load(); }
+    bool isDirect() { return direct; }
+    void close(int64_t size);
+private:
+    int     fd;
+    int     directFd;
+    bool    direct;
+    std::atomic<int64_t> end;
+
+    bool writeAll(int file, const void *data, size_t bytes, int64_t offset);
+};
+
+/* format a walk as a text line, returns the number of chars written */
+int formatWalk(const int *walk, int length, char *out);
+
+/* digits of `value`, returns the number of chars written */
+int formatInt(long long value, char *out);
+
+/*
+ * `value` with six decimals like "%f", at most formatFloatBytes chars.
+ * Shared with word2vec.c, hence the C linkage.
+ **/
+extern "C" int formatFloat(float value, char *out);
+#define formatFloatBytes 48
+
+/*
+ * NPY format 1.0 header of a C order `rows` x `cols` array of `descr`
+ * values, padded so that the data starts 64 byte aligned.
+ **/
+std::string npyHeader(const char *descr, long long rows, int cols);
+
+/*
+ * Text walk trace, one walk per line, consumed by word2vec.
+ * Threads format walks into large buffers appended to a single file.
+ **/
+class TextWalkOutput : public WalkOutput {
+public:
+    TextWalkOutput(const char *path, int _threadNum, int walkLength, bool direct);
+    ~TextWalkOutput();
+    void write(int tid, const int *walk, int length);
+    void close();
+
+    static const int bufferBytes = 1 << 22;
+private:
+    struct Buffer {
+        char    *data;
+        int     bytes;
+    };
+    int     threadNum;
+    int     lineBytes;
+    Buffer  *buffers;
+    ParallelFileWriter *writer;
+};
+
+/*
+ * Walks are packed into blocks and pushed to the trainer through a queue.
+ **/
+class QueueWalkOutput : public WalkOutput {
+public:
+    QueueWalkOutput(WalkQueue *_queue, int _threadNum);
+    ~QueueWalkOutput();
+    void write(int tid, const int *walk, int length);
+    void close();
+private:
+    WalkQueue   *queue;
+    int         threadNum;
+    /* block being filled by each thread */
+    WalkBlock   **pending;
+};
+
+#endif // WALKIO_H
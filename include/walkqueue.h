@@ -0,0 +1,106 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef WALKQUEUE_H
+#define WALKQUEUE_H
+
+#include <stdlib.h>
+#include <atomic>
+
+/*
+ * A batch of walks handed from the walkers to the trainer.
+ * Walks are stored back to back, each one prefixed by its length.
+ **/
+struct WalkBlock {
+    int     *data;
+    int     size;
+    int     capacity;
+    int     walkNum;
+
+    WalkBlock(int _capacity);
+    ~WalkBlock();
+
+    /* append a walk, returns false if the block has no room for it */
+    bool push(const int *walk, int length);
+    void clear() { size = 0; walkNum = 0; }
+};
+
+/*
+ * Bounded lock-free multi-producer multi-consumer ring of block pointers.
+ * Each cell carries a sequence number telling whether it is ready to be
+ * written or read at a given ticket (D. Vyukov's array based queue).
+ **/
+class BlockRing {
+public:
+    BlockRing(int _capacity);
+    ~BlockRing();
+
+    bool push(WalkBlock *block);
+    bool pop(WalkBlock *&block);
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        WalkBlock *block;
+    };
+    Cell    *cells;
+    size_t  mask;
+
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+/*
+ * Walk pipeline between walker threads (producers) and trainer threads
+ * (consumers). A fixed pool of blocks circulates through two rings, so
+ * producers are throttled once every block is waiting for the trainer.
+ **/
+class WalkQueue {
+public:
+    WalkQueue(int _blockNum, int _blockInts);
+    ~WalkQueue();
+
+    /* producer side */
+    WalkBlock *acquire();
+    void submit(WalkBlock *block);
+    void close();
+
+    /* consumer side, `take` returns nullptr once closed and drained */
+    WalkBlock *take();
+    void release(WalkBlock *block);
+
+    void setExpectedWalks(long long num) { expectedWalks.store(num); }
+    long long getExpectedWalks() { return expectedWalks.load(); }
+    int getBlockInts() { return blockInts; }
+private:
+    int         blockNum;
+    int         blockInts;
+    WalkBlock   **blocks;
+    BlockRing   filled;
+    BlockRing   empty;
+
+    std::atomic<bool>       closed;
+    std::atomic<long long>  expectedWalks;
+};
+
+#endif // WALKQUEUE_H
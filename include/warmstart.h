@@ -0,0 +1,59 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#ifndef WARMSTART_H
+#define WARMSTART_H
+
+#include <stdio.h>
+#include <vector>
+
+/*
+ * Tables of an earlier run to continue training from, widened to fp32.
+ * A checkpoint holds both the vertex and the context table; `txt`, `bin`
+ * and `npy` embedding files hold the vertex table only. Text files may
+ * leave vertices out, their rows are then missing.
+ **/
+class PreviousEmbedding {
+public:
+    PreviousEmbedding(const char *path);
+
+    long long   vertexNum;  /* vertices 0 .. vertexNum - 1 */
+    int         dim;
+
+    bool has(long long v) { return v >= 0 && v < vertexNum && present[v]; }
+    bool hasContext() { return !ctx.empty(); }
+    const float *vtxRow(long long v) { return vtx.data() + v * dim; }
+    const float *ctxRow(long long v) { return ctx.data() + v * dim; }
+private:
+    std::vector<float>  vtx;
+    std::vector<float>  ctx;
+    std::vector<char>   present;
+
+    void allocate(long long _vertexNum, int _dim);
+    void loadCheckpoint(FILE *file, const char *path);
+    void loadNpy(FILE *file, const char *path);
+    void loadText(FILE *file, const char *path);
+};
+
+#endif // WARMSTART_H
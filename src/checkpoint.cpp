@@ -0,0 +1,115 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void initCheckpointHeader(CheckpointHeader &header) {
+    memset(&header, 0, sizeof(CheckpointHeader));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+}
+
+Checkpoint::Checkpoint(const char *_path) : path(_path) {
+    this->busy = false;
+}
+
+Checkpoint::~Checkpoint() {
+    this->wait();
+}
+
+bool Checkpoint::load(const CheckpointHeader &expected, CheckpointHeader &header,
+                      std::vector<unsigned char> &done, char *vtx, char *ctx) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    if (fread(&header, sizeof(CheckpointHeader), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+        header.version != CHECKPOINT_VERSION) {
+        printf("%s is not a checkpoint\n", path.c_str());
+        exit(1);
+    }
+    if (header.precision != expected.precision || header.vertexNum != expected.vertexNum ||
+        header.dim != expected.dim || header.rowBytes != expected.rowBytes ||
+        header.blockNum != expected.blockNum || header.iterNum != expected.iterNum) {
+        printf("Checkpoint %s is for another graph, corpus or training setup\n", path.c_str());
+        exit(1);
+    }
+    long long tableBytes = (header.vertexNum + 1) * header.rowBytes;
+    done.resize(header.iterNum * header.blockNum);
+    if (fread(done.data(), 1, done.size(), file) != done.size() ||
+        fread(vtx, 1, tableBytes, file) != (size_t)tableBytes ||
+        fread(ctx, 1, tableBytes, file) != (size_t)tableBytes) {
+        printf("Truncated checkpoint %s\n", path.c_str());
+        exit(1);
+    }
+    fclose(file);
+    return true;
+}
+
+/*
+ * The progress flags are copied right away, the tables are read live by
+ * the writer thread.
+ **/
+bool Checkpoint::start(const CheckpointHeader &header, const std::atomic<unsigned char> *done,
+                       const char *vtx, const char *ctx) {
+    if (this->busy.exchange(true)) return false;
+    if (this->writer.joinable()) this->writer.join();
+    std::vector<unsigned char> flags(header.iterNum * header.blockNum);
+    for (size_t i = 0; i < flags.size(); i++)
+        flags[i] = done[i].load();
+    this->writer = std::thread(&Checkpoint::write, this, header, std::move(flags), vtx, ctx);
+    return true;
+}
+
+void Checkpoint::wait() {
+    if (this->writer.joinable()) this->writer.join();
+}
+
+/*
+ * A failed snapshot is reported and training goes on, the previous one
+ * still being in place.
+ **/
+void Checkpoint::write(CheckpointHeader header, std::vector<unsigned char> done,
+                       const char *vtx, const char *ctx) {
+    std::string temp = path + ".tmp";
+    FILE *file = fopen(temp.c_str(), "wb");
+    bool ok = file != nullptr;
+    if (ok) {
+        size_t tableBytes = (header.vertexNum + 1) * header.rowBytes;
+        ok = fwrite(&header, sizeof(CheckpointHeader), 1, file) == 1 &&
+             fwrite(done.data(), 1, done.size(), file) == done.size() &&
+             fwrite(vtx, 1, tableBytes, file) == tableBytes &&
+             fwrite(ctx, 1, tableBytes, file) == tableBytes;
+        ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+        fclose(file);
+    }
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        printf("\nCannot write checkpoint %s\n", path.c_str());
+        unlink(temp.c_str());
+    }
+    this->busy = false;
+}
@@ -0,0 +1,366 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "corpus.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <parallel/algorithm>
+
+static inline int putVarint(uint32_t value, unsigned char *out) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+static inline bool getVarint(const unsigned char *&in, const unsigned char *end, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && in < end; shift += 7) {
+        unsigned char byte = *in++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void initCorpusHeader(CorpusHeader &header, CorpusEncoding encoding, VertexIndexType vertexNum) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+    header.version   = CORPUS_VERSION;
+    header.encoding  = encoding;
+    header.vertexNum = vertexNum;
+    header.paramP    = 1.0f;
+    header.paramQ    = 1.0f;
+}
+
+CorpusCodec::CorpusCodec(CorpusEncoding _encoding, VertexIndexType _vertexNum) {
+    this->encoding      = _encoding;
+    this->vertexNum     = _vertexNum;
+    this->vertexToRank  = nullptr;
+    this->rankToVertex  = nullptr;
+}
+
+CorpusCodec::~CorpusCodec() {
+    free(this->vertexToRank);
+    free(this->rankToVertex);
+}
+
+void CorpusCodec::buildRank(int *degrees) {
+    this->vertexToRank = static_cast<VertexIndexType *>(
+        malloc(vertexNum * sizeof(VertexIndexType)));
+    this->rankToVertex = static_cast<VertexIndexType *>(
+        malloc(vertexNum * sizeof(VertexIndexType)));
+#pragma omp parallel for
+    for (VertexIndexType v = 0; v < vertexNum; v++)
+        rankToVertex[v] = v;
+    __gnu_parallel::stable_sort(rankToVertex, rankToVertex + vertexNum,
+        [degrees](VertexIndexType a, VertexIndexType b) { return degrees[a] > degrees[b]; });
+#pragma omp parallel for
+    for (VertexIndexType r = 0; r < vertexNum; r++)
+        vertexToRank[rankToVertex[r]] = r;
+}
+
+void CorpusCodec::extend(VertexIndexType _vertexNum) {
+    VertexIndexType oldNum = this->vertexNum;
+    this->vertexNum = std::max(oldNum, _vertexNum);
+    if (this->encoding != CORPUS_RANK) return;
+
+    this->rankToVertex = static_cast<VertexIndexType *>(
+        realloc(rankToVertex, vertexNum * sizeof(VertexIndexType)));
+    this->vertexToRank = static_cast<VertexIndexType *>(
+        realloc(vertexToRank, vertexNum * sizeof(VertexIndexType)));
+    for (VertexIndexType v = oldNum; v < vertexNum; v++)
+        rankToVertex[v] = v;
+#pragma omp parallel for
+    for (VertexIndexType r = 0; r < vertexNum; r++)
+        vertexToRank[rankToVertex[r]] = r;
+}
+
+void CorpusCodec::loadRank(FILE *file, int64_t offset) {
+    this->rankToVertex = static_cast<VertexIndexType *>(
+        malloc(vertexNum * sizeof(VertexIndexType)));
+    fseeko(file, offset, SEEK_SET);
+    if (fread(rankToVertex, sizeof(VertexIndexType), vertexNum, file) != (size_t)vertexNum) {
+        printf("Corrupted corpus rank table\n");
+        exit(1);
+    }
+}
+
+int CorpusCodec::encodeWalk(const int *walk, int length, unsigned char *out) {
+    int n = putVarint(length, out);
+    if (this->encoding == CORPUS_RANK) {
+        for (int i = 0; i < length; i++)
+            n += putVarint(vertexToRank[walk[i]], out + n);
+    } else {
+        int prev = 0;
+        for (int i = 0; i < length; i++) {
+            n += putVarint(zigzag(walk[i] - prev), out + n);
+            prev = walk[i];
+        }
+    }
+    return n;
+}
+
+bool CorpusCodec::decodeBlock(const unsigned char *in, int bytes, int walkNum, WalkBlock *block) {
+    const unsigned char *end = in + bytes;
+    int *data = block->data;
+    int size = 0;
+    uint32_t value;
+    block->clear();
+    for (int w = 0; w < walkNum; w++) {
+        if (!getVarint(in, end, value)) return false;
+        int length = (int)value;
+        if (size + length + 1 > block->capacity) return false;
+        data[size++] = length;
+        if (this->encoding == CORPUS_RANK) {
+            for (int i = 0; i < length; i++) {
+                if (!getVarint(in, end, value) || value >= (uint32_t)vertexNum) return false;
+                data[size++] = rankToVertex[value];
+            }
+        } else {
+            int prev = 0;
+            for (int i = 0; i < length; i++) {
+                if (!getVarint(in, end, value)) return false;
+                prev += unzigzag(value);
+                data[size++] = prev;
+            }
+        }
+    }
+    block->size = size;
+    block->walkNum = walkNum;
+    return true;
+}
+
+CorpusWriter::CorpusWriter(const char *path, CorpusHeader &_header, CorpusCodec *_codec,
+                           int _threadNum, bool direct) {
+    this->header    = _header;
+    this->codec     = _codec;
+    this->threadNum = _threadNum;
+    this->file      = new ParallelFileWriter(path, direct);
+    this->index     = new std::vector<CorpusBlockEntry>[_threadNum];
+    this->maxBlockInts = static_cast<int *>(calloc(_threadNum, sizeof(int)));
+
+    /* header and rank table come first, the header is rewritten on close */
+    size_t metaBytes = sizeof(CorpusHeader);
+    if (this->codec->getEncoding() == CORPUS_RANK) {
+        this->header.rankOffset = sizeof(CorpusHeader);
+        size_t rankBytes = this->header.vertexNum * sizeof(VertexIndexType);
+        this->file->writeAt(this->header.rankOffset, this->codec->getRankTable(), rankBytes);
+        metaBytes += rankBytes;
+    }
+    /* blocks start on an aligned offset so they can be written directly */
+    this->file->reserve(ParallelFileWriter::padded(metaBytes));
+}
+
+CorpusWriter::~CorpusWriter() {
+    delete this->file;
+    delete[] this->index;
+    free(this->maxBlockInts);
+}
+
+void CorpusWriter::appendBlock(int tid, unsigned char *data, int bytes, int walkNum, int ints) {
+    CorpusBlockEntry entry;
+    entry.offset    = this->file->append(data, bytes);
+    entry.walkNum   = walkNum;
+    entry.bytes     = bytes;
+    this->index[tid].push_back(entry);
+    this->maxBlockInts[tid] = std::max(this->maxBlockInts[tid], ints);
+}
+
+void CorpusWriter::close() {
+    std::vector<CorpusBlockEntry> merged;
+    for (int i = 0; i < threadNum; i++) {
+        merged.insert(merged.end(), this->index[i].begin(), this->index[i].end());
+        this->header.maxBlockInts = std::max(this->header.maxBlockInts, this->maxBlockInts[i]);
+    }
+    /* file order, so that walk ids follow the layout */
+    std::sort(merged.begin(), merged.end(),
+        [](const CorpusBlockEntry &a, const CorpusBlockEntry &b) { return a.offset < b.offset; });
+    this->header.walkNum = 0;
+    for (auto &entry : merged) {
+        entry.firstWalk = this->header.walkNum;
+        this->header.walkNum += entry.walkNum;
+    }
+
+    size_t indexBytes = merged.size() * sizeof(CorpusBlockEntry);
+    this->header.blockNum    = merged.size();
+    this->header.indexOffset = this->file->reserve(indexBytes);
+    this->file->writeAt(this->header.indexOffset, merged.data(), indexBytes);
+    this->file->writeAt(0, &this->header, sizeof(CorpusHeader));
+    int64_t size = this->header.indexOffset + indexBytes;
+    this->file->close(size);
+    std::cout << "Corpus: " << this->header.walkNum << " walks in "
+              << this->header.blockNum << " blocks, "
+              << size << " bytes" << std::endl;
+}
+
+bool corpusComplete(const char *path) {
+    /* the header is written last, a valid one means the writer closed the file */
+    CorpusHeader header;
+    struct stat st;
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    bool ok = fread(&header, sizeof(CorpusHeader), 1, file) == 1 &&
+              memcmp(header.magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) == 0 &&
+              fstat(fileno(file), &st) == 0 &&
+              st.st_size >= header.indexOffset + header.blockNum * (int64_t)sizeof(CorpusBlockEntry);
+    fclose(file);
+    return ok;
+}
+
+CorpusReader::CorpusReader(const char *path) {
+    this->codec = nullptr;
+    this->fd = open(path, O_RDONLY);
+    if (this->fd < 0) return;
+
+    FILE *file = fdopen(dup(this->fd), "rb");
+    if (fread(&this->header, sizeof(CorpusHeader), 1, file) != 1 ||
+        memcmp(this->header.magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) != 0) {
+        printf("%s is not a walk corpus\n", path);
+        exit(1);
+    }
+    this->codec = new CorpusCodec(
+        (CorpusEncoding)this->header.encoding, this->header.vertexNum);
+    if (this->header.encoding == CORPUS_RANK)
+        this->codec->loadRank(file, this->header.rankOffset);
+
+    this->index.resize(this->header.blockNum);
+    fseeko(file, this->header.indexOffset, SEEK_SET);
+    if (fread(this->index.data(), sizeof(CorpusBlockEntry), this->header.blockNum, file)
+            != (size_t)this->header.blockNum) {
+        printf("Corrupted corpus index in %s\n", path);
+        exit(1);
+    }
+    fclose(file);
+}
+
+CorpusReader::~CorpusReader() {
+    if (this->fd >= 0) ::close(this->fd);
+    delete this->codec;
+}
+
+bool CorpusReader::readRaw(int64_t idx, std::vector<unsigned char> &buffer) {
+    CorpusBlockEntry &entry = this->index[idx];
+    if (buffer.size() < (size_t)entry.bytes)
+        buffer.resize(entry.bytes);
+    return this->readRaw(idx, buffer.data());
+}
+
+bool CorpusReader::readRaw(int64_t idx, unsigned char *buffer) {
+    CorpusBlockEntry &entry = this->index[idx];
+    ssize_t done = 0;
+    while (done < entry.bytes) {
+        ssize_t n = pread(this->fd, buffer + done, entry.bytes - done, entry.offset + done);
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+bool CorpusReader::readBlock(int64_t idx, WalkBlock *block, std::vector<unsigned char> &buffer) {
+    if (!this->readRaw(idx, buffer)) return false;
+    CorpusBlockEntry &entry = this->index[idx];
+    return this->codec->decodeBlock(buffer.data(), entry.bytes, entry.walkNum, block);
+}
+
+CorpusWalkOutput::CorpusWalkOutput(const char *path, CorpusHeader &header, LSGraph *graph,
+                                   int _threadNum, bool direct) {
+    this->threadNum = _threadNum;
+    this->codec = new CorpusCodec((CorpusEncoding)header.encoding, graph->getNumberOfVertex());
+    this->ownCodec = true;
+    if (header.encoding == CORPUS_RANK)
+        this->codec->buildRank(graph->getDegree());
+    this->init(path, header, direct);
+}
+
+CorpusWalkOutput::CorpusWalkOutput(const char *path, CorpusHeader &header, CorpusCodec *_codec,
+                                   int _threadNum, bool direct) {
+    this->threadNum = _threadNum;
+    this->codec = _codec;
+    this->ownCodec = false;
+    this->init(path, header, direct);
+}
+
+void CorpusWalkOutput::init(const char *path, CorpusHeader &header, bool direct) {
+    this->writer = new CorpusWriter(path, header, this->codec, threadNum, direct);
+
+    this->buffers = new Buffer[threadNum];
+    for (int i = 0; i < threadNum; i++) {
+        /* one more walk always fits once the block size is reached */
+        this->buffers[i].data = static_cast<unsigned char *>(ParallelFileWriter::allocBuffer(
+            blockBytes + CorpusCodec::maxBytes(header.walkLength)));
+        this->buffers[i].bytes   = 0;
+        this->buffers[i].walkNum = 0;
+        this->buffers[i].ints    = 0;
+    }
+}
+
+CorpusWalkOutput::~CorpusWalkOutput() {
+    for (int i = 0; i < threadNum; i++)
+        free(this->buffers[i].data);
+    delete[] this->buffers;
+    delete this->writer;
+    if (this->ownCodec) delete this->codec;
+}
+
+void CorpusWalkOutput::flush(int tid) {
+    Buffer &buffer = this->buffers[tid];
+    if (buffer.walkNum == 0) return;
+    this->writer->appendBlock(tid, buffer.data, buffer.bytes, buffer.walkNum, buffer.ints);
+    buffer.bytes   = 0;
+    buffer.walkNum = 0;
+    buffer.ints    = 0;
+}
+
+void CorpusWalkOutput::write(int tid, const int *walk, int length) {
+    Buffer &buffer = this->buffers[tid];
+    buffer.bytes += this->codec->encodeWalk(walk, length, buffer.data + buffer.bytes);
+    buffer.walkNum++;
+    buffer.ints += length + 1;
+    if (buffer.bytes >= blockBytes)
+        this->flush(tid);
+}
+
+void CorpusWalkOutput::copyBlock(int tid, unsigned char *data, int bytes, int walkNum, int ints) {
+    this->writer->appendBlock(tid, data, bytes, walkNum, ints);
+}
+
+void CorpusWalkOutput::close() {
+    for (int i = 0; i < threadNum; i++)
+        this->flush(i);
+    this->writer->close();
+}
@@ -43,6 +43,10 @@ bool weighted = false;
 bool rand_weight = false;
 bool hetro = false;
 bool rand_hetro = false;
+bool temporal = false;
+
+/* timestamps of neighbors[i][j], temporal graphs only */
+int **stamps;
 
 std::string hetro_string;
 
@@ -66,16 +70,24 @@ void work(FILE *input, FILE *ot) {
     long long n, e;
     std::vector<int> xs, ys;
 
+    std::vector<int> ts;
+
     int maxi = 0;
-    int x, y;
+    int x, y, t;
     e = 0;
 
+    /* temporal edge lists have a timestamp as the third column */
     while (fscanf(input, "%d%d", &x, &y) > 0) {
+        if (temporal && fscanf(input, "%d", &t) != 1) {
+            std::cout << "Timestamp missing for edge " << x << " " << y << std::endl;
+            exit(1);
+        }
         e++;
         if (x > maxi) maxi = x;
         if (y > maxi) maxi = y;
         xs.push_back(x);
         ys.push_back(y);
+        if (temporal) ts.push_back(t);
     }
 
     std::cout << maxi << std::endl;
@@ -102,7 +114,32 @@ void work(FILE *input, FILE *ot) {
         neighbors[ys[j]][nodeindex[ys[j]]++] = xs[j];
     }
 
-    for (int i = 0; i < n; i++) {
+    if (temporal) {
+        /*
+         * neighbors sorted by (time, id), a neighbor appears once per
+         * distinct timestamp; nodeindex counts the entries kept
+         **/
+        stamps = static_cast<int **>(malloc(n * sizeof(int *)));
+        for (int i = 0; i < n; i++)
+            stamps[i] = static_cast<int *>(malloc(degrees[i] * sizeof(int)));
+        memset(nodeindex, 0, n * sizeof(int));
+        for (long long j = 0; j < e; j++) {
+            stamps[xs[j]][nodeindex[xs[j]]++] = ts[j];
+            stamps[ys[j]][nodeindex[ys[j]]++] = ts[j];
+        }
+        for (int i = 0; i < n; i++) {
+            std::vector<std::pair<int, int> > list(degrees[i]);
+            for (int j = 0; j < degrees[i]; j++)
+                list[j] = std::make_pair(stamps[i][j], neighbors[i][j]);
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            nodeindex[i] = list.size();
+            for (int j = 0; j < nodeindex[i]; j++) {
+                stamps[i][j] = list[j].first;
+                neighbors[i][j] = list[j].second;
+            }
+        }
+    } else for (int i = 0; i < n; i++) {
         nodeindex[i] = 0;
         if (degrees[i] == 0)
             continue;
@@ -130,6 +167,10 @@ void work(FILE *input, FILE *ot) {
     {
         if (degrees[i] == 0)
             continue;
+        if (temporal) {
+            fwrite(neighbors[i], sizeof(int), nodeindex[i], ot);
+            continue;
+        }
         fwrite(neighbors[i], sizeof(int), 1, ot);
         for (int j = 1; j < degrees[i]; j++)
             if (neighbors[i][j] != neighbors[i][j - 1])
@@ -137,19 +178,21 @@ void work(FILE *input, FILE *ot) {
     }
     srand((unsigned)time(NULL)); 
     if (rand_hetro) {
+        /* types start from 1 */
         int *type = new int[n];
-        for (long long i = 0; i < e; i++) {
-            type[i] = rand() % 5;
+        for (long long i = 0; i < n; i++) {
+            type[i] = rand() % 5 + 1;
         }
         fwrite(type, sizeof(int), n, ot);
     } else if (hetro) {
         int *type = new int[n];
         FILE *hetro_file = fopen(hetro_string.c_str(), "r");
-        memset(hetro_file, 0, sizeof(int) * n);
+        memset(type, 0, sizeof(int) * n);
         int node, w;
-        for (int i = 0; i < n; i++)
-            fscanf(hetro_file, "%d %d", &node, &w);
-        type[node] = w;
+        while (fscanf(hetro_file, "%d %d", &node, &w) == 2) {
+            if (node >= 0 && node < n) type[node] = w;
+        }
+        fclose(hetro_file);
         fwrite(type, sizeof(int), n, ot);
     }
     
@@ -161,6 +204,12 @@ void work(FILE *input, FILE *ot) {
         }
         fwrite(weight, sizeof(float), e, ot);
     }
+
+    /* timestamps come last, in edge order */
+    if (temporal) {
+        for (int i = 0; i < n; i++)
+            fwrite(stamps[i], sizeof(int), nodeindex[i], ot);
+    }
     
     fclose(ot);
 }
@@ -189,6 +238,8 @@ int main(int argc, char **argv) {
 
     if ((a = argPos(const_cast<char *>("-hetro"), argc, argv)) > 0)
         hetro = true;
+    if ((a = argPos(const_cast<char *>("-temporal"), argc, argv)) > 0)
+        temporal = true;
     
     if ((a = argPos(const_cast<char *>("-node-type"), argc, argv)) > 0) {
         hetro_string = std::string(argv[a + 1]);
@@ -26,6 +26,7 @@
 #include <omp.h>
 #include <iostream>
 #include <set>
+#include <parallel/algorithm>
 
 bool LSGraph::loadCRSGraph(string network_file) {
     ifstream inputFile(network_file, ios::in | ios::binary);
@@ -60,13 +61,7 @@ bool LSGraph::loadCRSGraph(string network_file) {
         for (int i = 0; i < nv; i++)
             degrees[i] = offsets[i + 1] - offsets[i];
 
-        if (this->weighted) {
-            cout << "Weighted Graph" << endl;
-            myrandom random(time(nullptr));
-            for (long long i = 0; i < ne; i++) {
-                inputFile.read(reinterpret_cast<char *>(&weights[i]), sizeof(float));
-            } 
-        } else for (long long i = 0; i < ne; i++) weights[i] = float(1);
+        /* `gen` writes vertex types before edge weights */
         this->type_num = 1;
         std::set<int> typeSet;
         if (this->hetro) {
@@ -78,6 +73,24 @@ bool LSGraph::loadCRSGraph(string network_file) {
             }
             this->type_num = typeSet.size();
             cout << "Num of types: " << type_num << endl;
+        } else for (long long i = 0; i < nv; i++) node_types[i] = 1;
+        if (this->weighted) {
+            cout << "Weighted Graph" << endl;
+            myrandom random(time(nullptr));
+            for (long long i = 0; i < ne; i++) {
+                inputFile.read(reinterpret_cast<char *>(&weights[i]), sizeof(float));
+            } 
+        } else for (long long i = 0; i < ne; i++) weights[i] = float(1);
+        /* timestamps come last */
+        if (this->temporal) {
+            cout << "Temporal Graph" << endl;
+            times = static_cast<TimeType *>(malloc(ne * sizeof(TimeType)));
+            inputFile.read(reinterpret_cast<char *>(times), ne * sizeof(TimeType));
+            if (inputFile.gcount() != (std::streamsize)(ne * sizeof(TimeType))) {
+                printf("Timestamps missing in %s\n", network_file.c_str());
+                exit(1);
+            }
+            this->sortByTime();
         }
         
         
@@ -97,7 +110,11 @@ bool LSGraph::loadCRSGraph(int argc, char **argv) {
     bool findInCmd = false;
     weighted = false;
     hetro = false;
+    temporal = false;
     for (int i = 0; i < argc; ++i) {
+        if (!strcmp("-temporal", argv[i])) {
+            temporal = true;
+        }
         if (!strcmp("-weighted", argv[i])) {
             weighted = true;
         }
@@ -127,12 +144,13 @@ bool LSGraph::loadCRSGraph(int argc, char **argv) {
 void LSGraph::init_reverse() {
 #pragma omp parallel for
     for (int src = 0; src < nv; src++) {
-        for (long long lastedgeidx = offsets[src]; lastedgeidx < offsets[src + 1]; lastedgeidx++) {
+        for (long long lastedgeidx = offsets[src]; lastedgeidx < offsets[src] + degrees[src]; lastedgeidx++) {
         int dst = edges[lastedgeidx];
         // accelerates
         if (degrees[src] < degrees[dst] || (degrees[src] == degrees[dst] && src < dst))
             continue;
-        long long pos = find_edge(dst, src); // find edge from dst to src
+        long long pos = temporal ? findTemporalEdge(dst, src, times[lastedgeidx])
+                                 : find_edge(dst, src); // find edge from dst to src
         
         edges_r[lastedgeidx] = pos;
         edges_r[pos] = lastedgeidx;
@@ -141,15 +159,15 @@ void LSGraph::init_reverse() {
   // check
 #pragma omp parallel for schedule(dynamic)
     for (int src = 0; src < nv; src++) {
-        for (long long lastedgeidx = offsets[src]; lastedgeidx < offsets[src + 1]; lastedgeidx++) {
+        for (long long lastedgeidx = offsets[src]; lastedgeidx < offsets[src] + degrees[src]; lastedgeidx++) {
             int dst = edges[lastedgeidx];
             long long rvs = edges_r[lastedgeidx];
-            if (rvs >= offsets[dst + 1] || rvs < offsets[dst] || edges[rvs] != src) {
+            if (rvs >= offsets[dst] + degrees[dst] || rvs < offsets[dst] || edges[rvs] != src) {
 #pragma omp critical
 {
                 cout << "ERROR for " << src << "->" << dst << " : "
                      << edges[rvs] << " wrong or " << rvs << " not between "
-                     << offsets[dst] << " and " << offsets[dst + 1] << endl;
+                     << offsets[dst] << " and " << offsets[dst] + degrees[dst] << endl;
 }
                 long long pos = find_edge(dst, src);
                 edges_r[lastedgeidx] = pos;
@@ -160,13 +178,68 @@ void LSGraph::init_reverse() {
 
 }
 
+/*
+ * Sort the neighbors of every vertex by (time, id), along with their
+ * weights. Files written by `gen -temporal` are sorted already.
+ **/
+void LSGraph::sortByTime() {
+#pragma omp parallel for schedule(dynamic, 256)
+    for (VertexIndexType v = 0; v < nv; v++) {
+        EdgeIndexType begin = offsets[v];
+        VertexIndexType degree = degrees[v];
+        bool sorted = true;
+        for (VertexIndexType k = 1; k < degree && sorted; k++) {
+            TimeType t0 = times[begin + k - 1], t1 = times[begin + k];
+            sorted = t0 < t1 || (t0 == t1 && edges[begin + k - 1] < edges[begin + k]);
+        }
+        if (sorted) continue;
+        std::vector<VertexIndexType> order(degree);
+        for (VertexIndexType k = 0; k < degree; k++) order[k] = k;
+        std::sort(order.begin(), order.end(), [&](VertexIndexType a, VertexIndexType b) {
+            if (times[begin + a] != times[begin + b])
+                return times[begin + a] < times[begin + b];
+            return edges[begin + a] < edges[begin + b];
+        });
+        std::vector<VertexIndexType> sortedEdges(degree);
+        std::vector<WeightType> sortedWeights(degree);
+        std::vector<TimeType> sortedTimes(degree);
+        for (VertexIndexType k = 0; k < degree; k++) {
+            sortedEdges[k] = edges[begin + order[k]];
+            sortedWeights[k] = weights[begin + order[k]];
+            sortedTimes[k] = times[begin + order[k]];
+        }
+        std::copy(sortedEdges.begin(), sortedEdges.end(), edges + begin);
+        std::copy(sortedWeights.begin(), sortedWeights.end(), weights + begin);
+        std::copy(sortedTimes.begin(), sortedTimes.end(), times + begin);
+    }
+}
+
+/* the edge from src to dst stamped `time`, found by binary search on time */
+EdgeIndexType LSGraph::findTemporalEdge(VertexIndexType src, VertexIndexType dst, TimeType time) {
+    TimeType *begin = times + offsets[src];
+    EdgeIndexType pos = offsets[src] + (std::lower_bound(begin, begin + degrees[src], time) - begin);
+    for (; pos < offsets[src] + degrees[src] && times[pos] == time; pos++) {
+        if (edges[pos] == dst)
+            return pos;
+    }
+    return -1;
+}
+
 long long LSGraph::find_edge(int src, int dst) {
-    long long l = offsets[src], r = offsets[src + 1], mid;
+    /* neighbors are ordered by time, not by id */
+    if (this->temporal) {
+        for (long long e = offsets[src]; e < offsets[src] + degrees[src]; e++) {
+            if (edges[e] == dst)
+                return e;
+        }
+        return -1;
+    }
+    long long l = offsets[src], r = offsets[src] + degrees[src], mid;
     while (l < r) {
         mid = (l + r) / 2;
         if (edges[mid] == dst)
             return mid;
-        if (edges[mid] > dst)
+        if (neighborLess(dst, edges[mid]))
             r = mid;
         else
             l = mid + 1;
@@ -191,7 +264,280 @@ WeightType LSGraph::getEdgeWeight(EdgeIndexType idx) {
 }
 
 int LSGraph::has_edge(int from, int to) {
-    return binary_search(&edges[offsets[from]], &edges[offsets[from + 1]], to);
+    return find_edge(from, to) >= 0;
+}
+
+void LSGraph::countTypeRanges(VertexIndexType v) {
+    VertexIndexType *range = typeOffsets + (EdgeIndexType)v * (maxType + 2);
+    VertexIndexType *neighbors = edges + offsets[v];
+    VertexIndexType pos = 0;
+    for (int type = 0; type <= maxType + 1; type++) {
+        while (pos < degrees[v] && node_types[neighbors[pos]] < type) pos++;
+        range[type] = pos;
+    }
+}
+
+void LSGraph::partitionByType() {
+    if (this->typeSorted) return;
+    if (this->temporal) {
+        printf("Temporal graphs keep neighbors sorted by time and cannot be partitioned by type\n");
+        exit(1);
+    }
+    if (!this->hetro) {
+        printf("Partitioning by type needs a heterogeneous graph (-hetro)\n");
+        exit(1);
+    }
+    this->maxType = 0;
+    for (VertexIndexType v = 0; v < nv; v++) {
+        if (node_types[v] < 0) {
+            printf("Negative type of vertex %d\n", v);
+            exit(1);
+        }
+        this->maxType = std::max(this->maxType, node_types[v]);
+    }
+    this->typeSorted = true;
+    this->typeOffsets = static_cast<VertexIndexType *>(
+        malloc((EdgeIndexType)nv * (maxType + 2) * sizeof(VertexIndexType)));
+
+#pragma omp parallel
+{
+    std::vector<std::pair<VertexIndexType, WeightType>> neighbors;
+#pragma omp for schedule(dynamic, 256)
+    for (VertexIndexType v = 0; v < nv; v++) {
+        EdgeIndexType begin = offsets[v];
+        neighbors.resize(degrees[v]);
+        for (VertexIndexType i = 0; i < degrees[v]; i++)
+            neighbors[i] = std::make_pair(edges[begin + i], weights[begin + i]);
+        std::sort(neighbors.begin(), neighbors.end(),
+            [this](const std::pair<VertexIndexType, WeightType> &a,
+                   const std::pair<VertexIndexType, WeightType> &b) {
+                return neighborLess(a.first, b.first);
+            });
+        for (VertexIndexType i = 0; i < degrees[v]; i++) {
+            edges[begin + i] = neighbors[i].first;
+            weights[begin + i] = neighbors[i].second;
+        }
+        countTypeRanges(v);
+    }
+}
+    /* every edge moved inside its vertex range */
+    if (!tossReverse) init_reverse();
+    cout << "Partitioned neighbors into " << maxType + 1 << " type ranges, "
+         << (((EdgeIndexType)nv * (maxType + 2) * sizeof(VertexIndexType)) >> 20)
+         << " MB" << endl;
+}
+
+bool readEdgeUpdates(const char *path, std::vector<EdgeUpdate> &updates) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        EdgeUpdate update;
+        update.insert = true;
+        update.weight = 1.0f;
+        if (*p == '+' || *p == '-') {
+            update.insert = *p == '+';
+            p++;
+        }
+        if (sscanf(p, "%d %d %f", &update.src, &update.dst, &update.weight) < 2) continue;
+        updates.push_back(update);
+    }
+    fclose(file);
+    return true;
+}
+
+EdgeIndexType LSGraph::slackFor(VertexIndexType degree) {
+    if (this->slack <= 0) return 0;
+    return std::max((EdgeIndexType)2, (EdgeIndexType)(degree * this->slack));
+}
+
+/*
+ * Copy the graph into new arrays leaving `slackFor(degree)` spare slots after
+ * every vertex. A vertex gets room for at least `minDegrees[v]` edges when given.
+ **/
+void LSGraph::relayout(const VertexIndexType *minDegrees) {
+    EdgeIndexType *newOffsets = static_cast<EdgeIndexType *>(
+        malloc((nv + 1) * sizeof(EdgeIndexType)));
+    newOffsets[0] = 0;
+    for (VertexIndexType v = 0; v < nv; v++) {
+        VertexIndexType degree = degrees[v];
+        if (minDegrees != nullptr)
+            degree = std::max(degree, minDegrees[v]);
+        newOffsets[v + 1] = newOffsets[v] + degree + slackFor(degree);
+    }
+    EdgeIndexType capacity = newOffsets[nv];
+
+    VertexIndexType *newEdges = static_cast<VertexIndexType *>(
+        malloc(capacity * sizeof(VertexIndexType)));
+    WeightType *newWeights = static_cast<WeightType *>(
+        malloc(capacity * sizeof(WeightType)));
+#pragma omp parallel for schedule(dynamic, 256)
+    for (VertexIndexType v = 0; v < nv; v++) {
+        memcpy(newEdges + newOffsets[v], edges + offsets[v], degrees[v] * sizeof(VertexIndexType));
+        memcpy(newWeights + newOffsets[v], weights + offsets[v], degrees[v] * sizeof(WeightType));
+    }
+    free(this->offsets);
+    free(this->edges);
+    free(this->weights);
+    this->offsets = newOffsets;
+    this->edges   = newEdges;
+    this->weights = newWeights;
+
+    if (!tossReverse) {
+        free(this->edges_r);
+        this->edges_r = static_cast<EdgeIndexType *>(
+            malloc(capacity * sizeof(EdgeIndexType)));
+    }
+}
+
+void LSGraph::reserveSlack(float ratio) {
+    if (this->temporal) {
+        printf("Edge updates are not supported on temporal graphs\n");
+        exit(1);
+    }
+    this->slack = ratio;
+    this->relayout(nullptr);
+    if (!tossReverse) init_reverse();
+    cout << "Reserved " << offsets[nv] - ne << " spare edge slots" << endl;
+}
+
+/*
+ * Merge the sorted neighbors of `v` with its updates, sorted by destination.
+ * Only the count is returned when `outEdges` is null.
+ **/
+VertexIndexType LSGraph::mergeAdjacency(VertexIndexType v, const EdgeUpdate *begin,
+        const EdgeUpdate *end, VertexIndexType *outEdges, WeightType *outWeights) {
+    const VertexIndexType *cur = edges + offsets[v];
+    const VertexIndexType *curEnd = cur + degrees[v];
+    const WeightType *curWeight = weights + offsets[v];
+    VertexIndexType n = 0;
+    while (cur < curEnd || begin < end) {
+        if (begin == end || (cur < curEnd && neighborLess(*cur, begin->dst))) {
+            if (outEdges != nullptr) {
+                outEdges[n] = *cur;
+                outWeights[n] = *curWeight;
+            }
+            n++;
+            cur++;
+            curWeight++;
+            continue;
+        }
+        /* the last update of an edge wins */
+        VertexIndexType dst = begin->dst;
+        while (begin + 1 < end && (begin + 1)->dst == dst) begin++;
+        if (begin->insert) {
+            if (outEdges != nullptr) {
+                outEdges[n] = dst;
+                outWeights[n] = this->weighted ? begin->weight : 1.0f;
+            }
+            n++;
+        }
+        begin++;
+        if (cur < curEnd && *cur == dst) {
+            cur++;
+            curWeight++;
+        }
+    }
+    return n;
+}
+
+bool LSGraph::applyEdgeBatch(const EdgeUpdate *updates, EdgeIndexType num,
+                             std::vector<VertexIndexType> &touched) {
+    if (this->temporal) {
+        printf("Edge updates are not supported on temporal graphs\n");
+        exit(1);
+    }
+    /* both directions of every edge, grouped by source */
+    std::vector<EdgeUpdate> half;
+    half.reserve(2 * num);
+    for (EdgeIndexType i = 0; i < num; i++) {
+        EdgeUpdate update = updates[i];
+        if (update.src < 0 || update.dst < 0 || update.src >= nv || update.dst >= nv)
+            continue;
+        half.push_back(update);
+        if (update.src != update.dst) {
+            std::swap(update.src, update.dst);
+            half.push_back(update);
+        }
+    }
+    __gnu_parallel::stable_sort(half.begin(), half.end(),
+        [this](const EdgeUpdate &a, const EdgeUpdate &b) {
+            return a.src < b.src || (a.src == b.src && neighborLess(a.dst, b.dst));
+        });
+
+    std::vector<EdgeIndexType> groups;
+    touched.clear();
+    for (EdgeIndexType i = 0; i < (EdgeIndexType)half.size(); i++) {
+        if (i == 0 || half[i].src != half[i - 1].src) {
+            groups.push_back(i);
+            touched.push_back(half[i].src);
+        }
+    }
+    groups.push_back(half.size());
+    EdgeIndexType groupNum = touched.size();
+
+    /* new degrees, the layout grows if a vertex runs out of slots */
+    VertexIndexType *newDegrees = static_cast<VertexIndexType *>(
+        malloc(groupNum * sizeof(VertexIndexType)));
+    bool overflow = false;
+#pragma omp parallel for schedule(dynamic, 64) reduction(||:overflow)
+    for (EdgeIndexType g = 0; g < groupNum; g++) {
+        VertexIndexType v = touched[g];
+        newDegrees[g] = mergeAdjacency(v, &half[groups[g]], &half[groups[g + 1]], nullptr, nullptr);
+        if (offsets[v] + newDegrees[g] > offsets[v + 1]) overflow = true;
+    }
+    if (overflow) {
+        VertexIndexType *minDegrees = static_cast<VertexIndexType *>(
+            calloc(nv, sizeof(VertexIndexType)));
+        for (EdgeIndexType g = 0; g < groupNum; g++)
+            minDegrees[touched[g]] = newDegrees[g];
+        if (this->slack <= 0) this->slack = 0.2f;
+        this->relayout(minDegrees);
+        free(minDegrees);
+    }
+
+    /* rewrite the touched neighbor lists in place */
+    EdgeIndexType edgeDiff = 0;
+#pragma omp parallel reduction(+:edgeDiff)
+{
+    std::vector<VertexIndexType> mergedEdges;
+    std::vector<WeightType> mergedWeights;
+#pragma omp for schedule(dynamic, 64)
+    for (EdgeIndexType g = 0; g < groupNum; g++) {
+        VertexIndexType v = touched[g];
+        mergedEdges.resize(newDegrees[g]);
+        mergedWeights.resize(newDegrees[g]);
+        mergeAdjacency(v, &half[groups[g]], &half[groups[g + 1]],
+                       mergedEdges.data(), mergedWeights.data());
+        memcpy(edges + offsets[v], mergedEdges.data(), newDegrees[g] * sizeof(VertexIndexType));
+        memcpy(weights + offsets[v], mergedWeights.data(), newDegrees[g] * sizeof(WeightType));
+        edgeDiff += newDegrees[g] - degrees[v];
+        degrees[v] = newDegrees[g];
+        if (typeSorted) countTypeRanges(v);
+    }
+}
+    this->ne += edgeDiff;
+    free(newDegrees);
+
+    /* only edges of touched vertices moved, unless everything was laid out again */
+    if (!tossReverse) {
+        if (overflow) {
+            init_reverse();
+        } else {
+#pragma omp parallel for schedule(dynamic, 64)
+            for (EdgeIndexType g = 0; g < groupNum; g++) {
+                VertexIndexType src = touched[g];
+                for (EdgeIndexType e = offsets[src]; e < offsets[src] + degrees[src]; e++) {
+                    EdgeIndexType pos = find_edge(edges[e], src);
+                    edges_r[e] = pos;
+                    if (pos >= 0) edges_r[pos] = e;
+                }
+            }
+        }
+    }
+    return overflow;
 }
 
 void LSGraph::printGraphInfo() {
@@ -24,10 +24,20 @@
 
 #include "../include/rw.h"
 #include "../include/train.h"
+#include "../include/walkqueue.h"
 #include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
 std::string graph_path;
 bool to_train = false;
+bool to_stream = false;
+bool has_corpus = false;
+bool legacy_w2v = false;
+char *checkpoint_path = nullptr;
+bool resume = false;
+int thread_num = 16;
 
 extern "C" {
     extern void train_main(int argc, char **argv);
@@ -41,17 +51,100 @@ void args(int argc, char **argv) {
     if ((a = argPos(const_cast<char *>("-train"), argc, argv)) > 0) {
         to_train = true;
     }  
+    if ((a = argPos(const_cast<char *>("-stream"), argc, argv)) > 0) {
+        to_stream = true;
+    }
+    if ((a = argPos(const_cast<char *>("-corpus"), argc, argv)) > 0) {
+        has_corpus = true;
+    }
+    if ((a = argPos(const_cast<char *>("-legacy-w2v"), argc, argv)) > 0) {
+        legacy_w2v = true;
+    }
+    if ((a = argPos(const_cast<char *>("-checkpoint"), argc, argv)) > 0) {
+        checkpoint_path = argv[a + 1];
+    }
+    if ((a = argPos(const_cast<char *>("-resume"), argc, argv)) > 0) {
+        resume = atoi(argv[a + 1]) != 0;
+    }
+    if ((a = argPos(const_cast<char *>("-threads"), argc, argv)) > 0) {
+        thread_num = atoi(argv[a + 1]);
+    }
 }
 
 int main(int argc, char **argv) {
     args(argc, argv);
+    if (legacy_w2v && (checkpoint_path != nullptr ||
+                       argPos(const_cast<char *>("-init-emb"), argc, argv) > 0)) {
+        printf("-checkpoint and -init-emb are not supported by -legacy-w2v\n");
+        exit(1);
+    }
+    if (to_train && to_stream && argPos(const_cast<char *>("-prev-corpus"), argc, argv) > 0) {
+        /* incremental walks go to a corpus, nothing would feed the trainer */
+        printf("-stream cannot be combined with -prev-corpus\n");
+        exit(1);
+    }
     LSGraph graph;
     std::cout << graph_path << std::endl;
     graph.loadCRSGraph(argc, argv);
 
+    if (to_train && to_stream) {
+        /* walkers feed the skip-gram trainer directly through memory */
+        WalkQueue queue(4 * thread_num, 1 << 16);
+        std::thread trainer([&]() { Train train(&graph, argc, argv, &queue); });
+        RandomWalk rw(&graph, argc, argv, &queue);
+        trainer.join();
+        return 0;
+    }
+
+    if (to_train && !has_corpus && !legacy_w2v) {
+        /*
+         * walks go to a temporary binary corpus the native trainer reads
+         * back, passed on to both as `-corpus`
+         **/
+        const char *tmpdir = getenv("TMPDIR");
+        std::string corpus;
+        int fd = -1;
+        if (checkpoint_path != nullptr) {
+            /* a checkpoint only makes sense with the walks it was trained on */
+            corpus = std::string(checkpoint_path) + ".walks";
+        } else {
+            corpus = std::string(tmpdir != nullptr ? tmpdir : "/tmp") + "/uninet-XXXXXX";
+            fd = mkstemp(&corpus[0]);
+            if (fd < 0) {
+                printf("Cannot create a temporary corpus in %s\n", tmpdir != nullptr ? tmpdir : "/tmp");
+                exit(1);
+            }
+            /*
+             * unlinked right away, so no exit path leaves it behind; walker
+             * and trainer reopen it through the descriptor kept here
+             **/
+            unlink(corpus.c_str());
+            corpus = "/proc/self/fd/" + std::to_string(fd);
+        }
+        std::vector<char *> corpusArgv(argv, argv + argc);
+        corpusArgv.push_back(const_cast<char *>("-corpus"));
+        corpusArgv.push_back(&corpus[0]);
+        if (!resume || !corpusComplete(corpus.c_str())) {
+            RandomWalk rw(&graph, corpusArgv.size(), corpusArgv.data());
+        }
+        Train train(&graph, corpusArgv.size(), corpusArgv.data());
+        /* checkpoint walks stay for a resume, a temporary corpus goes with fd */
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+
+    if (to_train && has_corpus) {
+        int a = argPos(const_cast<char *>("-corpus"), argc, argv);
+        if (!resume || !corpusComplete(argv[a + 1])) {
+            RandomWalk rw(&graph, argc, argv);
+        }
+        Train train(&graph, argc, argv);
+        return 0;
+    }
+
     RandomWalk rw(&graph, argc, argv);
     if (to_train) {
-        //Train train(&graph, argc, argv);
         train_main(argc, argv);
     }
     return 0;
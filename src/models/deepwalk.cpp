@@ -24,17 +24,73 @@
 
 #include "models/deepwalk.h"
 
-DeepWalk::DeepWalk(LSGraph *_graph) {
+DeepWalk::DeepWalk(LSGraph *_graph, int argc, char **argv) {
     this->walkLength = 80;
     graph = _graph;
+    this->aliasProb = nullptr;
+    this->aliasIndex = nullptr;
+    if (graph->weighted)
+        this->buildAlias();
     cout << "init deepwalk" << endl;
 }
 
+/*
+ * alias tables of all vertices, sized by the edge array capacity
+ **/
+void DeepWalk::buildAlias() {
+    free(this->aliasProb);
+    free(this->aliasIndex);
+    VertexIndexType vertexNum = graph->getNumberOfVertex();
+    EdgeIndexType capacity = graph->getOffsets()[vertexNum];
+    this->aliasProb = static_cast<float *>(malloc(capacity * sizeof(float)));
+    this->aliasIndex = static_cast<VertexIndexType *>(
+        malloc(capacity * sizeof(VertexIndexType)));
+#pragma omp parallel for schedule(dynamic, 256)
+    for (VertexIndexType v = 0; v < vertexNum; v++)
+        this->buildAlias(v);
+}
+
+/*
+ * Vose's alias method over the neighbor weights of `vertex`
+ * Slot k keeps neighbor k with probability aliasProb and gives way to
+ * neighbor aliasIndex otherwise.
+ **/
+void DeepWalk::buildAlias(VertexIndexType vertex) {
+    EdgeIndexType begin = graph->getOffsets()[vertex];
+    VertexIndexType degree = graph->getDegree()[vertex];
+    if (degree == 0) return;
+    buildAliasTable(graph->getWeights() + begin, degree,
+                    this->aliasProb + begin, this->aliasIndex + begin);
+}
+
+void DeepWalk::onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) {
+    if (this->aliasProb == nullptr) return;
+    if (relaid) {
+        this->buildAlias();
+        return;
+    }
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < touched.size(); i++)
+        this->buildAlias(touched[i]);
+}
+
+/*
+ * Unweighted graphs propose uniformly and weighted ones through the alias
+ * tables. Either way the proposal already matches the target, so the
+ * weight is constant.
+ **/
 float DeepWalk::computeWeight(State curState, long long nextEdgeIndex) {
-    //return this->graph->getWeights()[nextEdgeIndex];
     return 1.0;
 }
 
+EdgeIndexType DeepWalk::proposeEdge(
+        State curState, EdgeIndexType begin, VertexIndexType count, myrandom &random) {
+    VertexIndexType k = random.irand(count);
+    if (this->aliasProb != nullptr && random.drand() >= this->aliasProb[begin + k])
+        k = this->aliasIndex[begin + k];
+    return begin + k;
+}
+
 State DeepWalk::newState(State curState, long long nextEdgeIndex) {
     int nextVertex = this->graph->getEdges()[nextEdgeIndex];
     return std::make_pair(nextVertex, 0);
@@ -51,6 +107,3 @@ int DeepWalk::stateNum(int vertex) {
 float DeepWalk::maxWeight() {
     return 1.0;
 }
-
-
-
@@ -24,6 +24,8 @@
 
 #include "models/edge2vec.h"
 
+#include <thread>
+
 Edge2vec::Edge2vec(LSGraph *_graph, int argc, char **argv) {
     this->graph = _graph;
     assert(graph->isHetro());
@@ -32,120 +34,430 @@ Edge2vec::Edge2vec(LSGraph *_graph, int argc, char **argv) {
     this->param_q = 1.0f;
     this->iterNum = 4;
     this->walkLength = 80;
+    this->async = false;
+    this->refreshWalks = 0;
+    this->getArgs(argc, argv);
     this->init();
 }
+
+Edge2vec::~Edge2vec() {
+    this->reclaimMatrices(true);
+    free(this->matM.load());
+    this->freeStats();
+    delete[] this->seenEpoch;
+    for (SharedStats &totals : this->shared) {
+        delete[] totals.sum;
+        delete[] totals.squareSum;
+        delete[] totals.crossSum;
+    }
+    free(this->typeIndex);
+}
 /*
  * map a pair of node types onto a edge type
  */
 int Edge2vec::edgeType(int v1, int v2) {
-    return (v1 - 1) * this->type_num + v2 - 1;
+    return this->typeIndex[(v1 - 1) * this->type_num + v2 - 1];
 }
 
-void Edge2vec::init() {
+void Edge2vec::setGraph() {
     this->edges = graph->getEdges();
     this->node_types = graph->getTypes();
     this->offsets = graph->getOffsets();
     this->weights = graph->getWeights();
     this->degrees = graph->getDegree();
     //this->edges_r = graph->getEdges_r();
-    this->vertexNum = graph->getNumberOfVertex();
+}
+
+void Edge2vec::onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) {
+    this->setGraph();
+    /* inserted edges may join node types that were never adjacent */
+    this->collectTypes(touched.data(), touched.size());
+}
+
+/*
+ * give an edge type to every type pair found on the out edges of the
+ * vertices, or of all vertices if vertices is null
+ **/
+void Edge2vec::collectTypes(const VertexIndexType *vertices, long long n) {
+    int pairNum = this->type_num * this->type_num;
+    char *seen = static_cast<char *>(calloc(pairNum, sizeof(char)));
+#pragma omp parallel for schedule(dynamic, 256)
+    for (long long i = 0; i < n; i++) {
+        VertexIndexType v = vertices == nullptr ? (VertexIndexType)i : vertices[i];
+        int base = (node_types[v] - 1) * this->type_num - 1;
+        for (long long e = offsets[v]; e < offsets[v] + degrees[v]; e++) {
+            int pair = base + node_types[edges[e]];
+            if (!seen[pair]) seen[pair] = 1;
+        }
+    }
+    for (int pair = 0; pair < pairNum; pair++) {
+        if (seen[pair] && this->typeIndex[pair] < 0) {
+            this->typeIndex[pair] = this->typePairs.size();
+            this->typePairs.push_back(pair);
+        }
+    }
+    free(seen);
+    this->growTypes(this->typePairs.size());
+}
+
+/* extend an array of shared totals from oldNum to newNum zeroed entries */
+static void growTotals(std::atomic<long long> *&totals, int oldNum, int newNum) {
+    std::atomic<long long> *next = new std::atomic<long long>[newNum];
+    for (int i = 0; i < newNum; i++)
+        next[i].store(i < oldNum ? totals[i].load() : 0);
+    delete[] totals;
+    totals = next;
+}
+
+/*
+ * extend matrix M and the thread statistics to newNum edge types
+ * New rows and columns of M start at 1. The lower triangle layout keeps
+ * the existing cross products in place.
+ **/
+void Edge2vec::growTypes(int newNum) {
+    int oldNum = this->edge_type_num;
+    if (newNum <= oldNum) return;
+    float *oldM = this->matM.load();
+    float *newM = static_cast<float *>(malloc((long long)newNum * newNum * sizeof(float)));
+    for (int i = 0; i < newNum; i++) {
+        for (int j = 0; j < newNum; j++)
+            newM[i * newNum + j] = (i < oldNum && j < oldNum) ? oldM[i * oldNum + j] : 1.0f;
+    }
+
+    int oldCross = oldNum * (oldNum + 1) / 2;
+    int newCross = newNum * (newNum + 1) / 2;
+    for (int t = 0; this->stats != nullptr && t < threadNum; t++) {
+        TypeStats &s = this->stats[t];
+        s.sum = static_cast<long long *>(realloc(s.sum, newNum * sizeof(long long)));
+        s.squareSum = static_cast<long long *>(realloc(s.squareSum, newNum * sizeof(long long)));
+        s.crossSum = static_cast<long long *>(realloc(s.crossSum, newCross * sizeof(long long)));
+        s.count = static_cast<int *>(realloc(s.count, newNum * sizeof(int)));
+        s.touched = static_cast<int *>(realloc(s.touched, newNum * sizeof(int)));
+        memset(s.sum + oldNum, 0, (newNum - oldNum) * sizeof(long long));
+        memset(s.squareSum + oldNum, 0, (newNum - oldNum) * sizeof(long long));
+        memset(s.crossSum + oldCross, 0, (newCross - oldCross) * sizeof(long long));
+        memset(s.count + oldNum, 0, (newNum - oldNum) * sizeof(int));
+    }
+    for (int set = 0; this->async && set < 2; set++) {
+        growTotals(this->shared[set].sum, oldNum, newNum);
+        growTotals(this->shared[set].squareSum, oldNum, newNum);
+        growTotals(this->shared[set].crossSum, oldCross, newCross);
+    }
+    /* only called between rounds, no walker reads M meanwhile */
+    this->edge_type_num = newNum;
+    this->matM.store(newM);
+    free(oldM);
+}
 
-    this->edge_type_num = this->edgeType(type_num, type_num) + 1;
+void Edge2vec::init() {
+    this->setGraph();
+    this->vertexNum = graph->getNumberOfVertex();
 
-    this->matM = static_cast<float **>(
-        malloc(this->edge_type_num * sizeof(float *)));
-    for (int i = 0; i < this->edge_type_num; i++) {
-        this->matM[i] = static_cast<float *>(
-            malloc(this->edge_type_num * sizeof(float)));
-        for (int j = 0; j < this->edge_type_num; j++)
-            this->matM[i][j] = 1.0;
+    this->edge_type_num = 0;
+    this->matM.store(nullptr);
+    this->epoch.store(0);
+    this->seenEpoch = nullptr;
+    this->walkCount.store(0);
+    this->refreshing.store(false);
+    this->stats = nullptr;
+    this->activeSet.store(0);
+    for (int set = 0; set < 2; set++) {
+        this->shared[set].walkNum.store(0);
+        this->shared[set].sum = nullptr;
+        this->shared[set].squareSum = nullptr;
+        this->shared[set].crossSum = nullptr;
+        this->flushing[set].store(0);
     }
+    this->typeIndex = static_cast<int *>(
+        malloc(this->type_num * this->type_num * sizeof(int)));
+    for (int pair = 0; pair < this->type_num * this->type_num; pair++)
+        this->typeIndex[pair] = -1;
+    this->collectTypes(nullptr, this->vertexNum);
+    cout << "Edge2vec: " << this->edge_type_num << " of "
+         << this->type_num * this->type_num << " edge types occur" << endl;
 
     init_sigmoid_table();
 
-    this->typeCount = static_cast<int **>(
-        malloc(this->edge_type_num * sizeof(int *)));
-    for (int i = 0; i < this->edge_type_num; i++) {
-        this->typeCount[i] = static_cast<int *>(
-            malloc(vertexNum * sizeof(int)));
+    if (this->async && this->refreshWalks <= 0)
+        this->refreshWalks = this->vertexNum;
+    this->flushWalks = (int)std::min(64LL, this->refreshWalks);
+    if (this->async)
+        cout << "Edge2vec: refreshing M every " << this->refreshWalks << " walks" << endl;
+
+    this->initThreads(omp_get_max_threads());
+}
+
+/*
+ * statistics for every thread an OpenMP team may have, not only the
+ * `-threads` asked for, as handleWalk indexes them by thread number
+ **/
+void Edge2vec::initThreads(int _threadNum) {
+    this->freeStats();
+    this->threadNum = std::max(_threadNum, omp_get_max_threads());
+    int crossNum = edge_type_num * (edge_type_num + 1) / 2;
+    this->stats = new TypeStats[threadNum];
+    for (int t = 0; t < threadNum; t++) {
+        TypeStats &s = this->stats[t];
+        s.walkNum   = 0;
+        s.sum       = static_cast<long long *>(calloc(edge_type_num, sizeof(long long)));
+        s.squareSum = static_cast<long long *>(calloc(edge_type_num, sizeof(long long)));
+        s.crossSum  = static_cast<long long *>(calloc(crossNum, sizeof(long long)));
+        s.count     = static_cast<int *>(calloc(edge_type_num, sizeof(int)));
+        s.touched   = static_cast<int *>(malloc(edge_type_num * sizeof(int)));
+    }
+    /* threads not walking yet hold no version of M */
+    delete[] this->seenEpoch;
+    this->seenEpoch = new std::atomic<long long>[threadNum];
+    for (int t = 0; t < threadNum; t++)
+        this->seenEpoch[t].store(this->epoch.load());
+}
+
+void Edge2vec::freeStats() {
+    if (this->stats == nullptr) return;
+    for (int t = 0; t < threadNum; t++) {
+        free(this->stats[t].sum);
+        free(this->stats[t].squareSum);
+        free(this->stats[t].crossSum);
+        free(this->stats[t].count);
+        free(this->stats[t].touched);
     }
+    delete[] this->stats;
+    this->stats = nullptr;
 }
 
 std::pair<int, int> Edge2vec::nodeType(int edge) {
-    return std::make_pair(edge / this->type_num + 1, edge % this->type_num + 1);
+    int pair = this->typePairs[edge];
+    return std::make_pair(pair / this->type_num + 1, pair % this->type_num + 1);
 }
 
 /*
  * update edge type counting
+ * Each walk is one sample of the edge type counts. Its sums, square sums and
+ * cross products go to the statistics of the calling thread. Only the edge
+ * types the walk touched are visited, so a walk costs O(length + k^2) for k
+ * distinct types instead of the full triangle.
  **/
 void Edge2vec::handleWalk(int *walkSeq, int length) {
-    //cout << "WALK" << endl;
-    //cout << walkSeq[0] << endl;
-    int *count = static_cast<int *>(malloc(this->edge_type_num * sizeof(int)));
-    memset(count, 0, sizeof(int) * edge_type_num);
-    for (int i = 0; i < walkLength - 1; i++) {
+    int tid = omp_get_thread_num();
+    assert(tid < threadNum);
+    TypeStats &s = this->stats[tid];
+    int *count = s.count;
+    int *touched = s.touched;
+    int touchedNum = 0;
+    for (int i = 0; i < length - 1; i++) {
         int curType = this->edgeType(node_types[walkSeq[i]], node_types[walkSeq[i + 1]]);
-        count[curType]++;
+        if (count[curType]++ == 0)
+            touched[touchedNum++] = curType;
+    }
+    for (int a = 0; a < touchedNum; a++) {
+        int i = touched[a];
+        long long c = count[i];
+        s.sum[i] += c;
+        s.squareSum[i] += c * c;
+        long long *cross = s.crossSum + i * (i + 1) / 2;
+        for (int b = 0; b < touchedNum; b++) {
+            int j = touched[b];
+            if (j <= i) cross[j] += c * count[j];
+        }
+    }
+    for (int a = 0; a < touchedNum; a++)
+        count[touched[a]] = 0;
+    s.walkNum++;
+
+    if (!this->async) return;
+    if (s.walkNum >= this->flushWalks)
+        this->flushStats(s);
+    /* between walks this thread holds no version of M */
+    this->seenEpoch[tid].store(this->epoch.load());
+    long long walks = this->walkCount.fetch_add(1) + 1;
+    /* one walker refreshes M while the others keep walking on the old one */
+    if (walks % this->refreshWalks == 0 && !this->refreshing.exchange(true)) {
+        this->refreshMatrix();
+        this->refreshing.store(false);
+    }
+}
+
+/*
+ * add the statistics of a thread to the active shared totals and clear them
+ * The flush registers in flushing before adding, and backs off if the set
+ * was switched meanwhile, so a refresh never reads a set being added to.
+ **/
+void Edge2vec::flushStats(TypeStats &s) {
+    int set;
+    for (;;) {
+        set = this->activeSet.load();
+        this->flushing[set].fetch_add(1);
+        if (this->activeSet.load() == set) break;
+        this->flushing[set].fetch_sub(1);
+    }
+    SharedStats &totals = this->shared[set];
+    int crossNum = edge_type_num * (edge_type_num + 1) / 2;
+    for (int i = 0; i < edge_type_num; i++) {
+        if (s.sum[i] == 0) continue;
+        totals.sum[i].fetch_add(s.sum[i], std::memory_order_relaxed);
+        totals.squareSum[i].fetch_add(s.squareSum[i], std::memory_order_relaxed);
+        s.sum[i] = 0;
+        s.squareSum[i] = 0;
     }
-    for (int i = 0; i < this->edge_type_num; i++) {
-        this->typeCount[i][walkSeq[0]] = count[i];
+    for (int idx = 0; idx < crossNum; idx++) {
+        if (s.crossSum[idx] == 0) continue;
+        totals.crossSum[idx].fetch_add(s.crossSum[idx], std::memory_order_relaxed);
+        s.crossSum[idx] = 0;
     }
-    free(count);
+    totals.walkNum.fetch_add(s.walkNum, std::memory_order_relaxed);
+    s.walkNum = 0;
+    this->flushing[set].fetch_sub(1);
 }
+
 /*
  * update matrix M after an iteration
+ * The statistics start afresh for the next iteration. No walker runs
+ * between rounds, so every retired version of M can go.
  **/
 void Edge2vec::handleIter() {
-    long long *flatSum = static_cast<long long *>(malloc(this->edge_type_num * sizeof(long long)));
-    long long *squareSum = static_cast<long long *>(malloc(this->edge_type_num * sizeof(long long)));
-
-    for (int i = 0; i < this->edge_type_num; i++) {
-        flatSum[i] = 0;
-        squareSum[i] = 0;
-        for (int j = 0; j < vertexNum; j++) {
-            flatSum[i] += (long long)typeCount[i][j];
-            //cout << flatSum[i] << endl;
-            squareSum[i] += (long long)(typeCount[i][j] * typeCount[i][j]);
+    if (this->async) {
+        for (int t = 0; t < threadNum; t++)
+            this->flushStats(this->stats[t]);
+    }
+    this->refreshMatrix();
+
+    int crossNum = edge_type_num * (edge_type_num + 1) / 2;
+    for (int t = 0; t < threadNum; t++) {
+        TypeStats &s = this->stats[t];
+        s.walkNum = 0;
+        memset(s.sum, 0, edge_type_num * sizeof(long long));
+        memset(s.squareSum, 0, edge_type_num * sizeof(long long));
+        memset(s.crossSum, 0, crossNum * sizeof(long long));
+    }
+    this->reclaimMatrices(true);
+}
+
+/*
+ * compute the next version of matrix M
+ * Reduces the statistics and turns the Pearson correlation of every pair of
+ * edge types into a weight factor. The default mode reads the thread
+ * statistics after a round; the async mode switches the shared totals and
+ * reads the set walkers no longer flush into.
+ **/
+void Edge2vec::refreshMatrix() {
+    int typeNum = this->edge_type_num;
+    int crossNum = typeNum * (typeNum + 1) / 2;
+    double *flatSum = static_cast<double *>(calloc(typeNum, sizeof(double)));
+    double *squareSum = static_cast<double *>(calloc(typeNum, sizeof(double)));
+    double *prodSum = static_cast<double *>(calloc(crossNum, sizeof(double)));
+    double n = 0;
+    if (this->async) {
+        int set = this->activeSet.load();
+        this->activeSet.store(1 - set);
+        while (this->flushing[set].load() != 0)
+            std::this_thread::yield();
+        SharedStats &totals = this->shared[set];
+        n = totals.walkNum.exchange(0);
+        for (int i = 0; i < typeNum; i++) {
+            flatSum[i] = totals.sum[i].exchange(0);
+            squareSum[i] = totals.squareSum[i].exchange(0);
+        }
+        for (int idx = 0; idx < crossNum; idx++)
+            prodSum[idx] = totals.crossSum[idx].exchange(0);
+    } else {
+        for (int t = 0; t < threadNum; t++) {
+            n += this->stats[t].walkNum;
+            for (int i = 0; i < typeNum; i++) {
+                flatSum[i] += this->stats[t].sum[i];
+                squareSum[i] += this->stats[t].squareSum[i];
+            }
+        }
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int idx = 0; idx < crossNum; idx++) {
+            for (int t = 0; t < threadNum; t++)
+                prodSum[idx] += this->stats[t].crossSum[idx];
         }
     }
-    /* pearson correlation */
-    for (int i = 0; i < this->edge_type_num; i++) {
+    /* nothing walked since the last version, which stays */
+    if (n == 0) {
+        free(flatSum);
+        free(squareSum);
+        free(prodSum);
+        return;
+    }
+
+    float *curM = this->matM.load(std::memory_order_acquire);
+    float *nextM = static_cast<float *>(malloc((long long)typeNum * typeNum * sizeof(float)));
+    memcpy(nextM, curM, (long long)typeNum * typeNum * sizeof(float));
+
+    /* pearson correlation, the async refresh runs on a single walker thread */
+#pragma omp parallel for schedule(dynamic) if(!async)
+    for (int i = 0; i < typeNum; i++) {
         for (int j = 0; j <= i; j++) {
-            if (flatSum[i] == 0 || flatSum[j] == 0) continue;
-            long long prodSum = 0;
-            for (int walkIdx = 0; walkIdx < vertexNum; walkIdx++)
-                prodSum += (long long)(typeCount[i][walkIdx] * (long long)typeCount[j][walkIdx]);
-            long long nume = (long long)vertexNum * (long long)prodSum - (long long)flatSum[i] * (long long)flatSum[j];
-            double denom = sqrt(double(
-                (vertexNum * squareSum[i] - flatSum[i] * flatSum[i]) *
-                (vertexNum * squareSum[j] - flatSum[j] * flatSum[j])
-            ));
-            if (isnan(denom)) continue;
-            if (denom != 0.0)
-                this->matM[i][j] = fast_sigmoid(double(nume) / denom);
+            if (n == 0 || flatSum[i] == 0 || flatSum[j] == 0) continue;
+            double nume = n * prodSum[i * (i + 1) / 2 + j] - flatSum[i] * flatSum[j];
+            /* isnan is compiled away with -Ofast, so no square root of a negative */
+            double varI = n * squareSum[i] - flatSum[i] * flatSum[i];
+            double varJ = n * squareSum[j] - flatSum[j] * flatSum[j];
+            if (varI <= 0 || varJ <= 0) continue;
+            nextM[i * typeNum + j] = fast_sigmoid(nume / sqrt(varI * varJ));
         }
     }
 
-    for (int i = 0; i < this->edge_type_num; i++) {
-        for (int j = i + i; j < this->edge_type_num; j++) {
-            this->matM[i][j] = this->matM[j][i];
+    for (int i = 0; i < typeNum; i++) {
+        for (int j = i + 1; j < typeNum; j++) {
+            nextM[i * typeNum + j] = nextM[j * typeNum + i];
         }
     }
+
+    this->publishMatrix(nextM);
+    free(flatSum);
+    free(squareSum);
+    free(prodSum);
+}
+
+/*
+ * swap in the next version of M
+ * The replaced version is retired rather than freed, as walkers of the
+ * async mode may still be reading it.
+ **/
+void Edge2vec::publishMatrix(float *next) {
+    float *prev = this->matM.exchange(next);
+    long long replaced = this->epoch.fetch_add(1) + 1;
+    this->retired.emplace_back(prev, replaced);
+    this->reclaimMatrices(false);
+}
+
+/*
+ * free the retired versions of M no walker can still read, or all of them
+ * when no walker runs
+ * Only the refreshing thread, or the main thread between rounds, touches
+ * retired.
+ **/
+void Edge2vec::reclaimMatrices(bool all) {
+    long long safe = this->epoch.load();
+    for (int t = 0; !all && t < threadNum; t++)
+        safe = std::min(safe, this->seenEpoch[t].load());
+    size_t kept = 0;
+    for (auto &version : this->retired) {
+        if (version.second <= safe)
+            free(version.first);
+        else
+            this->retired[kept++] = version;
+    }
+    this->retired.resize(kept);
 }
 
 float Edge2vec::computeWeight(State curState, long long nextEdgeIndex) {
     int curVertex = curState.first;
     int prevVertex = edges[offsets[curVertex] + curState.second];
     int nextVertex = edges[nextEdgeIndex];
-    float factorM = this->matM[edgeType(node_types[prevVertex], node_types[curVertex])]
-                              [edgeType(node_types[curVertex], node_types[nextVertex])];
+    const float *curM = this->matM.load(std::memory_order_acquire);
+    float factorM = curM[edgeType(node_types[prevVertex], node_types[curVertex]) * edge_type_num +
+                         edgeType(node_types[curVertex], node_types[nextVertex])];
+    /* node2vec's bias: 1 / p back, 1 to a neighbor of prev, 1 / q farther */
     float alpha = 1.0f;
-    if (param_q != 1.0f || param_q != 1.0f) {
+    if (param_p != 1.0f || param_q != 1.0f) {
         if (prevVertex == nextVertex) 
             alpha = 1.0f / param_p;
         else if (graph->has_edge(prevVertex, nextVertex)) 
-            alpha = 1.0f / param_q;
-        else alpha = 1.0f;
+            alpha = 1.0f;
+        else alpha = 1.0f / param_q;
     }
     return factorM * alpha * weights[nextEdgeIndex];
 }
@@ -163,9 +475,17 @@ State Edge2vec::getInitialState(int initialVertex) {
     return std::make_pair(initialVertex, randOffset);
 }
 
+State Edge2vec::resumeState(const int *walk, int pos) {
+    /* the state is the offset of the previous vertex among the neighbors */
+    long long prevEdge = graph->find_edge(walk[pos], walk[pos - 1]);
+    int prevOffset = prevEdge < 0 ? 0 : (int)(prevEdge - offsets[walk[pos]]);
+    return std::make_pair(walk[pos], prevOffset);
+}
+
 
 int Edge2vec::getIter() {
-    return this->iterNum;
+    /* the async mode refreshes M within a single sweep */
+    return this->async ? 1 : this->iterNum;
 }
 
 void Edge2vec::getArgs(int argc, char **argv) {
@@ -174,6 +494,10 @@ void Edge2vec::getArgs(int argc, char **argv) {
         this->param_p = atof(argv[a + 1]);
     if ((a = argPos(const_cast<char *>("-q"), argc, argv)) > 0)
         this->param_q = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-async"), argc, argv)) > 0)
+        this->async = true;
+    if ((a = argPos(const_cast<char *>("-refresh"), argc, argv)) > 0)
+        this->refreshWalks = atoll(argv[a + 1]);
 }
 
 int Edge2vec::stateNum(int vertex) {
@@ -30,59 +30,83 @@ Fairwalk::Fairwalk(LSGraph *_graph, int argc, char **argv) {
 
     this->param_p = 1.0;
     this->param_q = 1.0;
+    this->walkLength = 80;
 
+    this->getArgs(argc, argv);
     this->init();
 }
 
 void Fairwalk::init() {
+    this->setGraph();
+    this->vertexNum = graph->getNumberOfVertex();
 
+    this->preProc();
+}
+
+void Fairwalk::setGraph() {
     this->edges = graph->getEdges();
     this->node_types = graph->getTypes();
     this->offsets = graph->getOffsets();
     this->weights = graph->getWeights();
-    this->vertexNum = graph->getNumberOfVertex();
     this->degrees = graph->getDegree();
-
-    this->preProc();
 }
 
-// get total number of each node type
+/*
+ * Number of neighbors of each node type. Sorting the neighbors by type gives
+ * every vertex a row of type range offsets, so the count of a type is the
+ * length of its range. The graph keeps the ranges up to date on updates.
+ **/
 void Fairwalk::preProc() {
-    this->neighborAttr = static_cast<int **>(
-        malloc(graph->getNumberOfVertex() * sizeof(int *)));
-    for (int i = 0; i < this->vertexNum; i++) {
-        this->neighborAttr[i] = static_cast<int *>(
-            malloc((this->type_num + 1) * sizeof(int32_t)));
-        for (int type = 1; type <= this->type_num; type++) {
-            int cnt = 0;
-            for (long long offset = 0; offset < degrees[i]; offset++) {
-                int neighborIndex = edges[offsets[i] + offset];
-                if (node_types[neighborIndex] == type) cnt++;
-            }
-            this->neighborAttr[i][type] = cnt;
-        }
-    }
+    this->graph->partitionByType();
+    this->setGraph();
+}
+
+void Fairwalk::onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) {
+    this->setGraph();
 }
 
 float Fairwalk::computeWeight(State curState, long long nextEdgeIndex) {
-    cout << "F" << endl;
     int curVertex = curState.first;
     int prevVertex = edges[offsets[curVertex] + curState.second];
     int nextVertex = edges[nextEdgeIndex];
 
-    int nextType = node_types[edges[nextEdgeIndex]];
-
+    /* node2vec's bias: 1 / p back, 1 to a neighbor of prev, 1 / q farther */
     float alpha = 1.0f;
-    if (param_q != 1.0f || param_q != 1.0f) {
+    if (param_p != 1.0f || param_q != 1.0f) {
         if (prevVertex == nextVertex) 
             alpha = 1.0f / param_p;
         else if (graph->has_edge(prevVertex, nextVertex)) 
-            alpha = 1.0f / param_q;
-        else alpha = 1.0f;
+            alpha = 1.0f;
+        else alpha = 1.0f / param_q;
     }
 
-    return (float)weights[nextEdgeIndex] * alpha / 
-           (float)neighborAttr[curVertex][nextType]; 
+    /* the 1 / |neighbors of the type| factor is the proposal itself */
+    return (float)weights[nextEdgeIndex] * alpha;
+}
+
+/*
+ * Pick a neighbor type uniformly among the types present, then a member of
+ * that type uniformly. Every type gets the same share of proposals, so only
+ * the edge weight and the p/q correction are left to the M-H test.
+ **/
+EdgeIndexType Fairwalk::proposeEdge(State curState, EdgeIndexType begin, VertexIndexType count,
+                                    myrandom &random) {
+    int curVertex = curState.first;
+    int maxType = graph->getMaxType();
+    EdgeIndexType typeBegin;
+    VertexIndexType typeCount;
+    int present = 0;
+    for (int type = 0; type <= maxType; type++) {
+        graph->typeRange(curVertex, type, typeBegin, typeCount);
+        if (typeCount > 0) present++;
+    }
+    int pick = random.irand(present);
+    for (int type = 0; type <= maxType; type++) {
+        graph->typeRange(curVertex, type, typeBegin, typeCount);
+        if (typeCount > 0 && pick-- == 0)
+            return typeBegin + random.irand(typeCount);
+    }
+    return begin + random.irand(count);
 }
 
 State Fairwalk::newState(State curState, long long nextEdgeIndex) {
@@ -96,13 +120,23 @@ State Fairwalk::getInitialState(int initialVertex) {
     return std::make_pair(initialVertex, 0);
 }
 
+State Fairwalk::resumeState(const int *walk, int pos) {
+    /* the state is the offset of the previous vertex among the neighbors */
+    long long prevEdge = graph->find_edge(walk[pos], walk[pos - 1]);
+    int prevOffset = prevEdge < 0 ? 0 : (int)(prevEdge - offsets[walk[pos]]);
+    return std::make_pair(walk[pos], prevOffset);
+}
+
 int Fairwalk::stateNum(int vertex) {
-    return 1;
+    /* second order, one state per previous vertex */
+    return this->degrees[vertex];
 }
 
 void Fairwalk::getArgs(int argc, char **argv) {
     int a = 0;
-    if ((a = argPos(const_cast<char *>("-arg"), argc, argv)) > 0) ;
-        
+    if ((a = argPos(const_cast<char *>("-p"), argc, argv)) > 0)
+        this->param_p = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-q"), argc, argv)) > 0)
+        this->param_q = atof(argv[a + 1]);
 }
 
@@ -25,14 +25,16 @@
 #include "models/metapath.h"
 
 #include <assert.h>
+#include <sstream>
 
 Metapath2vec::Metapath2vec(LSGraph *_graph, int argc, char **argv) {
     this->graph = _graph;
-    this->metaLength = 0;
     this->walkLength = 80;
 
     this->getArgs(argc, argv);
 
+    /* neighbors of the next metapath type are proposed directly */
+    this->graph->partitionByType();
     this->init();
 }
 
@@ -44,58 +46,118 @@ void Metapath2vec::init() {
 }
 
 float Metapath2vec::computeWeight(State curState, long long nextEdgeIndex) {
-    int prevPosition = curState.second;
-    int curVertex = curState.first;
-    //cout << curVertex << endl;
-    if (node_types[edges[nextEdgeIndex]] == metapath[(prevPosition + 1) % 4]) {
+    if (node_types[edges[nextEdgeIndex]] == nextType[position(curState)]) {
         return weights[nextEdgeIndex];
     } else {
-        
         return 0;
     }
 }
 
 State Metapath2vec::newState(State curState, long long nextEdgeIndex) {
-    int nextPosition = (curState.second + 1) % 4;
     int nextVertex = edges[nextEdgeIndex];
-    return std::make_pair(nextVertex, nextPosition);
+    return std::make_pair(nextVertex, nextSlot[position(curState)]);
 }
 
 State Metapath2vec::getInitialState(int initialVertex) {
-    if (node_types[initialVertex] != metapath[0]) {
-
+    if (slotNum(node_types[initialVertex]) == 0) {
         return std::make_pair(-1, 0);
     }
     return std::make_pair(initialVertex, 0);
 }
 
+State Metapath2vec::resumeState(const int *walk, int pos) {
+    /* a position of the current type following one of the previous type */
+    int curType = node_types[walk[pos]];
+    int prevType = node_types[walk[pos - 1]];
+    for (int slot = 0; slot < slotNum(curType); slot++) {
+        int p = typePositions[slotBegin[curType] + slot];
+        if (positionType[prevPosition[p]] == prevType)
+            return std::make_pair(walk[pos], slot);
+    }
+    return std::make_pair(-1, 0);
+}
+
+void Metapath2vec::candidateRange(State curState, EdgeIndexType &begin, VertexIndexType &count) {
+    graph->typeRange(curState.first, nextType[position(curState)], begin, count);
+}
+
 int Metapath2vec::stateNum(int vertex) {
-    return 5;
+    return slotNum(node_types[vertex]);
 }
 
 void Metapath2vec::parseMeta() {
-    bool bad = false;
-    int len = this->metaString.length();
-
-    /* Legal metapath check */
-    for (auto c : this->metaString) {
-        if (!(c > '0' && c <= '9')) {
-            bad = false;
-            break;
+    std::vector<std::vector<int>> metapaths;
+    std::stringstream stream(this->metaString);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::vector<int> metapath;
+        for (auto c : item) {
+            if (!(c > '0' && c <= '9')) {
+                printf("Illegal metapath %s, types must be digits from 1 to 9\n", item.c_str());
+                exit(1);
+            }
+            metapath.push_back(c - '0');
+        }
+        /* Metapath should be loop */
+        if (metapath.size() < 2 || metapath.front() != metapath.back()) {
+            printf("Metapath %s must begin and end with the same type\n", item.c_str());
+            exit(1);
         }
+        metapath.pop_back();
+        metapaths.push_back(metapath);
     }
-    assert(bad == false);
-
-    /* Metapath should be loop */
-    assert(this->metaString[0] == this->metaString[len - 1]);
-
-    this->metapath = static_cast<int *>(malloc(this->metaLength * sizeof(int)));
+    if (metapaths.empty()) {
+        printf("No metapath given\n");
+        exit(1);
+    }
+    this->buildTables(metapaths);
+}
 
-    for (int idx = 0; idx < len; idx++) {
-        this->metapath[idx] = this->metaString[idx] - '0';
-        assert(this->metapath[idx] <= this->graph->getTypeNum());
+void Metapath2vec::buildTables(std::vector<std::vector<int>> &metapaths) {
+    this->positionNum = 0;
+    this->maxType = 0;
+    for (auto &metapath : metapaths) {
+        this->positionNum += metapath.size();
+        for (int type : metapath)
+            this->maxType = std::max(this->maxType, type);
+    }
+    this->positionType = static_cast<int *>(malloc(positionNum * sizeof(int)));
+    this->nextPosition = static_cast<int *>(malloc(positionNum * sizeof(int)));
+    this->prevPosition = static_cast<int *>(malloc(positionNum * sizeof(int)));
+    this->nextType     = static_cast<int *>(malloc(positionNum * sizeof(int)));
+    this->nextSlot     = static_cast<int *>(malloc(positionNum * sizeof(int)));
+
+    int base = 0;
+    for (auto &metapath : metapaths) {
+        int cycle = metapath.size();
+        for (int i = 0; i < cycle; i++) {
+            this->positionType[base + i] = metapath[i];
+            this->nextPosition[base + i] = base + (i + 1) % cycle;
+            this->prevPosition[base + i] = base + (i + cycle - 1) % cycle;
+        }
+        base += cycle;
     }
 
+    /* group positions by type, the slot of a position is its rank in its group */
+    int *slotOf = static_cast<int *>(malloc(positionNum * sizeof(int)));
+    this->slotBegin = static_cast<int *>(calloc(maxType + 2, sizeof(int)));
+    this->typePositions = static_cast<int *>(malloc(positionNum * sizeof(int)));
+    for (int p = 0; p < positionNum; p++)
+        this->slotBegin[positionType[p] + 1]++;
+    for (int type = 0; type <= maxType; type++)
+        this->slotBegin[type + 1] += this->slotBegin[type];
+    for (int p = 0; p < positionNum; p++) {
+        int type = positionType[p];
+        slotOf[p] = 0;
+        for (int q = 0; q < p; q++)
+            if (positionType[q] == type) slotOf[p]++;
+        this->typePositions[slotBegin[type] + slotOf[p]] = p;
+    }
+    for (int p = 0; p < positionNum; p++) {
+        this->nextType[p] = positionType[nextPosition[p]];
+        this->nextSlot[p] = slotOf[nextPosition[p]];
+    }
+    free(slotOf);
 }
 
 void Metapath2vec::getArgs(int argc, char **argv) {
@@ -107,9 +169,4 @@ void Metapath2vec::getArgs(int argc, char **argv) {
     }
     /* Metapath must be provided */
     assert(a > 0);
-    
-    if ((a = argPos(const_cast<char *>("-length"), argc, argv)) > 0) {
-        this->length = std::atoi(argv[a + 1]);
-    }
-        
-}
\ No newline at end of file
+}
@@ -31,21 +31,106 @@ Node2vec::Node2vec(LSGraph *_graph, int argc, char **argv) {
     graph = _graph;
     init();
     getArgs(argc, argv);
+    buildTriangles();
     this->max_weight = std::max(1.0f, 1.0f / this->paramQ);
     this->max_weight = std::max(1.0f, 1.0f / this->paramP);
     std::cout << "init node2vec" << std::endl;
 }
 
 void Node2vec::init() {
+    this->setGraph();
+    this->walkLength = 80;
+    paramP = 0.25;
+    paramQ = 0.25;
+    triThreshold = 0;
+    triOffset = nullptr;
+    triBits = nullptr;
+}
+
+/*
+ * precompute which neighbor pairs of a low degree vertex form a triangle
+ * The memory, one offset per vertex plus degree * ceil(degree / 64) words
+ * for every covered vertex, is reported before anything is allocated.
+ **/
+void Node2vec::buildTriangles() {
+    if (this->triThreshold <= 0) return;
+    int vertexNum = graph->getNumberOfVertex();
+    long long total = 0, covered = 0;
+    for (int v = 0; v < vertexNum; v++) {
+        long long degree = degrees[v];
+        if (degree == 0 || degree > this->triThreshold) continue;
+        total += degree * ((degree + 63) / 64);
+        covered++;
+    }
+    long long bytes = vertexNum * static_cast<long long>(sizeof(long long)) +
+                      total * static_cast<long long>(sizeof(uint64_t));
+    std::cout << "Triangle bitsets for " << covered << " vertices of degree <= "
+              << this->triThreshold << ", " << (bytes >> 20) << " MB" << std::endl;
+
+    this->triOffset = static_cast<long long *>(malloc(vertexNum * sizeof(long long)));
+    total = 0;
+    for (int v = 0; v < vertexNum; v++) {
+        long long degree = degrees[v];
+        if (degree == 0 || degree > this->triThreshold) {
+            this->triOffset[v] = -1;
+            continue;
+        }
+        this->triOffset[v] = total;
+        total += degree * ((degree + 63) / 64);
+    }
+    this->triBits = static_cast<uint64_t *>(calloc(total, sizeof(uint64_t)));
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int v = 0; v < vertexNum; v++) {
+        if (this->triOffset[v] < 0) continue;
+        long long degree = degrees[v];
+        long long words = (degree + 63) / 64;
+        int *neighbors = edges + offsets[v];
+        for (long long j = 0; j < degree; j++) {
+            uint64_t *row = this->triBits + this->triOffset[v] + j * words;
+            for (long long k = 0; k < degree; k++) {
+                if (graph->has_edge(neighbors[j], neighbors[k]))
+                    row[k >> 6] |= 1ULL << (k & 63);
+            }
+        }
+    }
+}
+
+/*
+ * whether the target of nextEdgeIndex is adjacent to src, the vertex the
+ * walk came from
+ **/
+int Node2vec::adjacent(State curState, int src, long long nextEdgeIndex) {
+    long long base = this->triOffset == nullptr ? -1 : this->triOffset[curState.first];
+    if (base < 0)
+        return graph->has_edge(src, edges[nextEdgeIndex]);
+    long long words = (degrees[curState.first] + 63) / 64;
+    long long k = nextEdgeIndex - offsets[curState.first];
+    const uint64_t *row = this->triBits + base + curState.second * words;
+    return (row[k >> 6] >> (k & 63)) & 1;
+}
+
+void Node2vec::setGraph() {
     this->edges = graph->getEdges();
     this->edges_r = graph->getEdges_r();
     this->weights = graph->getWeights();
     this->degrees = graph->getDegree();
     this->offsets = graph->getOffsets();
-    this->walkLength = 80;
-    paramP = 0.25;
-    paramQ = 0.25;
-    
+}
+
+void Node2vec::onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) {
+    this->setGraph();
+    if (this->triOffset == nullptr) return;
+    /*
+     * The bitsets are indexed by neighbor position, which a relayout keeps.
+     * An inserted or deleted edge (u, w) changes the bitsets of u and w, and
+     * of their common neighbors. Those fall back to has_edge from now on.
+     **/
+    for (size_t i = 0; i < touched.size(); i++) {
+        VertexIndexType v = touched[i];
+        this->triOffset[v] = -1;
+        for (long long e = offsets[v]; e < offsets[v] + degrees[v]; e++)
+            this->triOffset[edges[e]] = -1;
+    }
 }
 
 float Node2vec::computeWeight(State curState, long long nextEdgeIndex) {
@@ -55,7 +140,7 @@ float Node2vec::computeWeight(State curState, long long nextEdgeIndex) {
     float nextW = weights[nextEdgeIndex];
     if (src == nextV) {
         return nextW / paramP;
-    } else if (graph->has_edge(src, nextV)) {
+    } else if (this->adjacent(curState, src, nextEdgeIndex)) {
         return nextW;
     } else {
         return nextW / paramQ;
@@ -74,12 +159,21 @@ State Node2vec::getInitialState(int initialVertex) {
     return std::make_pair(initialVertex, randOffset);
 }
 
+State Node2vec::resumeState(const int *walk, int pos) {
+    /* the state is the offset of the previous vertex among the neighbors */
+    long long prevEdge = graph->find_edge(walk[pos], walk[pos - 1]);
+    int prevOffset = prevEdge < 0 ? 0 : (int)(prevEdge - offsets[walk[pos]]);
+    return std::make_pair(walk[pos], prevOffset);
+}
+
 void Node2vec::getArgs(int argc, char **argv) {
     int a = 0;
     if ((a = argPos(const_cast<char *>("-p"), argc, argv)) > 0)
         this->paramP = atof(argv[a + 1]);
     if ((a = argPos(const_cast<char *>("-q"), argc, argv)) > 0)
         this->paramQ = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-tri-threshold"), argc, argv)) > 0)
+        this->triThreshold = atoi(argv[a + 1]);
 }
 
 int Node2vec::stateNum(int vertex) {
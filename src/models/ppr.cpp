@@ -0,0 +1,62 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "models/ppr.h"
+
+PPRWalk::PPRWalk(LSGraph *_graph, int argc, char **argv) : DeepWalk(_graph, argc, argv) {
+    this->restartProb = 0.15f;
+    this->restart = false;
+    this->getArgs(argc, argv);
+    cout << "init ppr, " << (this->restart ? "restart" : "stop")
+         << " with probability " << this->restartProb << endl;
+}
+
+/*
+ * In the stop mode walk lengths are geometric with mean 1 / restartProb,
+ * capped by the walk length. In the restart mode every walk has the full
+ * length and visits the neighborhood of its source over and over.
+ **/
+WalkAction PPRWalk::nextAction(State curState, int step, myrandom &random) {
+    if (random.drand() >= this->restartProb)
+        return WALK_STEP;
+    return this->restart ? WALK_RESTART : WALK_STOP;
+}
+
+void PPRWalk::getArgs(int argc, char **argv) {
+    int a = 0;
+    if ((a = argPos(const_cast<char *>("-restart-prob"), argc, argv)) > 0)
+        this->restartProb = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-ppr-mode"), argc, argv)) > 0) {
+        if (!strcmp(argv[a + 1], "restart"))
+            this->restart = true;
+        else if (strcmp(argv[a + 1], "stop")) {
+            printf("Unknown PPR mode %s, use stop or restart\n", argv[a + 1]);
+            exit(1);
+        }
+    }
+    if (this->restartProb <= 0 || this->restartProb >= 1) {
+        printf("-restart-prob must be in (0, 1)\n");
+        exit(1);
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "models/temporal.h"
+
+TemporalWalk::TemporalWalk(LSGraph *_graph, int argc, char **argv) {
+    this->graph = _graph;
+    this->walkLength = 80;
+    if (!graph->isTemporal()) {
+        printf("Temporal walks need a temporal graph (-temporal)\n");
+        exit(1);
+    }
+    this->offsets = graph->getOffsets();
+    this->edges = graph->getEdges();
+    this->degrees = graph->getDegree();
+    this->weights = graph->getWeights();
+    this->times = graph->getTimes();
+    cout << "init temporal walk" << endl;
+}
+
+/* proposals are uniform over the valid suffix, the weight is the edge's */
+float TemporalWalk::computeWeight(State curState, EdgeIndexType nextEdgeIndex) {
+    return weights[nextEdgeIndex];
+}
+
+void TemporalWalk::candidateRange(State curState, EdgeIndexType &begin, VertexIndexType &count) {
+    begin = offsets[curState.first] + curState.second;
+    count = degrees[curState.first] - curState.second;
+}
+
+State TemporalWalk::newState(State curState, EdgeIndexType nextEdgeIndex) {
+    VertexIndexType nextV = edges[nextEdgeIndex];
+    return std::make_pair(nextV, (int)graph->laterThan(nextV, times[nextEdgeIndex]));
+}
+
+/*
+ * A walk may start at any time. Random initial states start from a random
+ * neighbor of the time ordered list, so from a random start time.
+ **/
+State TemporalWalk::getInitialState(int initialVertex) {
+    return std::make_pair(initialVertex, 0);
+}
+
+int TemporalWalk::stateNum(int vertex) {
+    return degrees[vertex];
+}
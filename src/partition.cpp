@@ -0,0 +1,201 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "partition.h"
+#include "utils.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* create an unlinked file in `dir`, it lives as long as `fd` or a mapping */
+static int openSwapFile(const char *dir) {
+    std::string path = std::string(dir) + "/uninet-swap-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        printf("Cannot create a swap file in %s\n", dir);
+        exit(1);
+    }
+    unlink(path.c_str());
+    return fd;
+}
+
+/*
+ * a fixed seed, so the same graph is partitioned the same way every run
+ **/
+void Partitioning::assign(int vertexNum, int _partNum) {
+    this->partNum = _partNum;
+    this->partSize = ((long long)vertexNum + partNum) / partNum;
+    this->vertex.resize(vertexNum);
+    for (int v = 0; v < vertexNum; v++)
+        vertex[v] = v;
+    myrandom random(1);
+    for (int i = vertexNum - 1; i > 0; i--)
+        std::swap(vertex[i], vertex[random.lrand() % (i + 1)]);
+    this->slot.resize(vertexNum);
+    for (int r = 0; r < vertexNum; r++)
+        slot[vertex[r]] = r;
+}
+
+SwapTable::SwapTable(const char *dir, long long rows, long long _rowBytes, long long _partRows) {
+    this->rowBytes = _rowBytes;
+    this->partRows = _partRows;
+    this->bytes = rows * rowBytes;
+    int fd = openSwapFile(dir);
+    /* a sparse file, unwritten rows read as zeros */
+    if (ftruncate(fd, bytes) != 0) {
+        printf("Cannot allocate %lld MB in %s\n", bytes >> 20, dir);
+        exit(1);
+    }
+    void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        printf("Cannot map a swap file of %lld MB\n", bytes >> 20);
+        exit(1);
+    }
+    this->base = static_cast<char *>(addr);
+}
+
+SwapTable::~SwapTable() {
+    munmap(base, bytes);
+}
+
+void SwapTable::load(int part) {
+    this->advise(part, MADV_WILLNEED);
+}
+
+void SwapTable::evict(int part) {
+    this->advise(part, MADV_DONTNEED);
+}
+
+/*
+ * Only the pages inside the partition are advised, so a page shared with
+ * a neighbouring partition stays mapped.
+ **/
+void SwapTable::advise(int part, int advice) {
+    long long page = sysconf(_SC_PAGESIZE);
+    long long begin = part * partRows * rowBytes;
+    long long end = std::min((part + 1) * partRows * rowBytes, bytes);
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (end > begin)
+        madvise(base + begin, end - begin, advice);
+}
+
+PairBuckets::PairBuckets(const char *dir, int _partNum) {
+    this->partNum = _partNum;
+    this->pairs = 0;
+    int bucketNum = partNum * partNum;
+    this->locks = new std::mutex[bucketNum];
+    for (int b = 0; b < bucketNum; b++) {
+        FILE *file = fdopen(openSwapFile(dir), "w+b");
+        if (file == nullptr) {
+            printf("Cannot open bucket file %d of %d, too many partitions for the open file limit?\n",
+                   b, bucketNum);
+            exit(1);
+        }
+        this->files.push_back(file);
+    }
+    this->offset.assign(bucketNum, 0);
+    this->carry.resize(bucketNum);
+}
+
+PairBuckets::~PairBuckets() {
+    for (FILE *file : files)
+        fclose(file);
+    delete[] locks;
+}
+
+PairBuckets::Writer::Writer(PairBuckets *_owner) {
+    this->owner = _owner;
+    this->buffers.resize(owner->partNum * owner->partNum);
+}
+
+PairBuckets::Writer::~Writer() {
+    this->flush();
+}
+
+void PairBuckets::Writer::append(int bucket, int center, const int *contexts, int count) {
+    std::vector<int> &buffer = buffers[bucket];
+    buffer.push_back(center);
+    buffer.push_back(count);
+    buffer.insert(buffer.end(), contexts, contexts + count);
+    owner->pairs += count;
+    if (buffer.size() >= flushInts)
+        this->flush(bucket);
+}
+
+void PairBuckets::Writer::flush() {
+    for (size_t b = 0; b < buffers.size(); b++)
+        this->flush(b);
+}
+
+void PairBuckets::Writer::flush(int bucket) {
+    std::vector<int> &buffer = buffers[bucket];
+    if (buffer.empty()) return;
+    {
+        std::lock_guard<std::mutex> guard(owner->locks[bucket]);
+        if (fwrite(buffer.data(), sizeof(int), buffer.size(), owner->files[bucket]) != buffer.size()) {
+            printf("Cannot write walk pairs to the swap directory\n");
+            exit(1);
+        }
+    }
+    buffer.clear();
+}
+
+void PairBuckets::rewind(int bucket) {
+    fflush(files[bucket]);
+    fseek(files[bucket], 0, SEEK_SET);
+    this->offset[bucket] = 0;
+    this->carry[bucket].clear();
+}
+
+long long PairBuckets::size(int bucket) {
+    fflush(files[bucket]);
+    struct stat st;
+    if (fstat(fileno(files[bucket]), &st) != 0) return 0;
+    return st.st_size / sizeof(int);
+}
+
+bool PairBuckets::next(int bucket, long long limit, std::vector<int> &chunk) {
+    chunk.swap(carry[bucket]);
+    size_t have = chunk.size();
+    long long want = std::min((long long)chunkInts, limit - offset[bucket]);
+    if (want > 0) {
+        chunk.resize(have + want);
+        size_t got = fread(&chunk[have], sizeof(int), want, files[bucket]);
+        have += got;
+        offset[bucket] += got;
+    }
+    /* keep the trailing partial record for the next call */
+    size_t end = 0;
+    while (end + 2 <= have && end + 2 + chunk[end + 1] <= have)
+        end += 2 + chunk[end + 1];
+    carry[bucket].assign(chunk.begin() + end, chunk.begin() + have);
+    chunk.resize(end);
+    return end > 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "rewalk.h"
+
+#include <omp.h>
+#include <iostream>
+
+int64_t loadEdgeDelta(const char *path, VertexIndexType vertexNum, char *affected) {
+    std::vector<EdgeUpdate> updates;
+    if (!readEdgeUpdates(path, updates)) {
+        printf("Cannot open edge delta %s\n", path);
+        exit(1);
+    }
+    int64_t edgeNum = 0, skipped = 0;
+    for (auto &update : updates) {
+        if (update.src < 0 || update.dst < 0 || update.src >= vertexNum || update.dst >= vertexNum) {
+            skipped++;
+            continue;
+        }
+        affected[update.src] = 1;
+        affected[update.dst] = 1;
+        edgeNum++;
+    }
+    if (skipped > 0)
+        std::cout << "Skipped " << skipped << " delta edges out of the vertex range" << std::endl;
+    return edgeNum;
+}
+
+CorpusVertexIndex::CorpusVertexIndex(CorpusReader *reader, VertexIndexType _vertexNum, int threadNum) {
+    this->vertexNum = _vertexNum;
+    this->blockNum  = reader->getBlockNum();
+    this->offsets   = static_cast<int64_t *>(calloc(vertexNum + 1, sizeof(int64_t)));
+    this->blockInts = static_cast<int *>(malloc(blockNum * sizeof(int)));
+
+    /* distinct vertices of every block */
+    std::vector<int> *visited = new std::vector<int>[blockNum];
+    bool corrupted = false;
+
+#pragma omp parallel num_threads(threadNum)
+{
+    WalkBlock *block = reader->newBlock();
+    std::vector<unsigned char> buffer;
+#pragma omp for schedule(dynamic)
+    for (int64_t b = 0; b < blockNum; b++) {
+        if (!reader->readBlock(b, block, buffer)) {
+            corrupted = true;
+            continue;
+        }
+        std::vector<int> &vertices = visited[b];
+        int pos = 0;
+        while (pos < block->size) {
+            int length = block->data[pos];
+            vertices.insert(vertices.end(), block->data + pos + 1, block->data + pos + 1 + length);
+            pos += length + 1;
+        }
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        if (!vertices.empty() && (vertices.front() < 0 || vertices.back() >= vertexNum)) {
+            corrupted = true;
+            continue;
+        }
+        this->blockInts[b] = block->size;
+        for (int v : vertices) {
+#pragma omp atomic
+            this->offsets[v + 1]++;
+        }
+    }
+    delete block;
+}
+    if (corrupted) {
+        printf("Corrupted corpus block or vertex out of range\n");
+        exit(1);
+    }
+
+    for (VertexIndexType v = 0; v < vertexNum; v++)
+        offsets[v + 1] += offsets[v];
+    this->blocks = static_cast<int64_t *>(malloc(offsets[vertexNum] * sizeof(int64_t)));
+
+    int64_t *cursor = static_cast<int64_t *>(malloc(vertexNum * sizeof(int64_t)));
+    memcpy(cursor, offsets, vertexNum * sizeof(int64_t));
+#pragma omp parallel for schedule(dynamic) num_threads(threadNum)
+    for (int64_t b = 0; b < blockNum; b++) {
+        for (int v : visited[b]) {
+            int64_t slot;
+#pragma omp atomic capture
+            slot = cursor[v]++;
+            this->blocks[slot] = b;
+        }
+        std::vector<int>().swap(visited[b]);
+    }
+    free(cursor);
+    delete[] visited;
+}
+
+CorpusVertexIndex::~CorpusVertexIndex() {
+    free(this->offsets);
+    free(this->blocks);
+    free(this->blockInts);
+}
+
+size_t CorpusVertexIndex::memoryBytes() {
+    return (vertexNum + 1) * sizeof(int64_t) + offsets[vertexNum] * sizeof(int64_t)
+         + blockNum * sizeof(int);
+}
@@ -29,8 +29,9 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-RandomWalk::RandomWalk(LSGraph *_graph, int _argc, char **_argv) {
+RandomWalk::RandomWalk(LSGraph *_graph, int _argc, char **_argv, WalkQueue *_queue) {
     this->graph = _graph;
+    this->queue = _queue;
     this->threadNum = 16;
     this->nodeWNum = 10;
     getArgs(_argc, _argv);
@@ -38,12 +39,25 @@ RandomWalk::RandomWalk(LSGraph *_graph, int _argc, char **_argv) {
     this->walkNum = graph->getNumberOfVertex() * nodeWNum;
     this->argc = _argc;
     this->argv = _argv;
+    if (this->updatePath != nullptr) {
+        if (!readEdgeUpdates(this->updatePath, this->updates)) {
+            printf("Cannot open edge updates %s\n", this->updatePath);
+            exit(1);
+        }
+        /* room for insertions, so most batches are applied in place */
+        graph->reserveSlack(this->slack);
+    }
     RWModel *model = this->init();
+    model->initThreads(this->threadNum);
 
     /* sampler management */
     this->samplerManager = new SamplerManager(model, this->graph);
 
-    this->runModel(model);
+    if (this->prevCorpusPath != nullptr)
+        this->runIncremental(model);
+    else
+        this->runModel(model);
+    delete model;
 }
 
 /**
@@ -53,7 +67,7 @@ RWModel *RandomWalk::init() {
     RWModel *model = nullptr;
 
     if (this->type == DEEPWALK) {
-        DeepWalk *deepWalk = new DeepWalk(graph);
+        DeepWalk *deepWalk = new DeepWalk(graph, argc, argv);
         model = (RWModel *)deepWalk;
         std::cout << "DeepWalk" << std::endl;
     } else if (this->type == NODE2VEC) {
@@ -72,7 +86,17 @@ RWModel *RandomWalk::init() {
         Edge2vec *edge2vec = new Edge2vec(graph, argc, argv);
         model = (RWModel *)edge2vec;
         std::cout << "Edge2vec" << std::endl;
+    } else if (this->type == PPR) {
+        PPRWalk *ppr = new PPRWalk(graph, argc, argv);
+        model = (RWModel *)ppr;
+        std::cout << "PPR" << std::endl;
+    } else if (this->type == TEMPORAL) {
+        TemporalWalk *temporal = new TemporalWalk(graph, argc, argv);
+        model = (RWModel *)temporal;
+        std::cout << "Temporal walk" << std::endl;
     }
+    if (this->walkLength > 0)
+        model->setWalkLength(this->walkLength);
     return model;
 } 
 
@@ -80,54 +104,63 @@ void RandomWalk::runModel(RWModel *model) {
     int walkLength = model->getWalkLength();
     auto begin = chrono::steady_clock::now();
     int vertexNum = graph->getNumberOfVertex();
-    char outputPath[100];
-    char outputtxt[100];
 
-    FILE *files[40];
-    FILE *txt[40];
-    memset(files, 0, sizeof(files));
     int iterNum = model->getIter();
-    int totalNum = iterNum * walkNum;
+    long long totalNum = iterNum * walkNum;
 
     int cnt = 0;
-    if (this->out) {
-        std::string prefix = "txt";
-	    if (access(prefix.c_str(), 0) == -1)
-		    mkdir(prefix.c_str(), S_IRWXU);
-        else 
-            int stat = system("rm txt/*");
-        for (int i = 0; i < threadNum; i++) {
-            sprintf(outputPath, "./walks/rw_out_%d", i);
-            files[i] = fopen(outputPath, "wb");
-            sprintf(outputtxt, "./txt/rw_out_%d", i);
-            txt[i] = fopen(outputtxt, "w");
+    WalkOutput *output = nullptr;
+    if (this->queue != nullptr) {
+        if (walkLength + 1 > this->queue->getBlockInts()) {
+            printf("-length %d is too long to stream, queue blocks hold %d ints\n",
+                   walkLength, this->queue->getBlockInts());
+            exit(1);
         }
+        this->queue->setExpectedWalks(totalNum);
+        output = new QueueWalkOutput(this->queue, threadNum);
+    } else if (this->corpusPath != nullptr) {
+        CorpusHeader header;
+        this->fillCorpusHeader(header, walkLength);
+        output = new CorpusWalkOutput(this->corpusPath, header, graph, threadNum, this->directIO);
+    } else if (this->out) {
+        output = new TextWalkOutput(this->walkPath, threadNum, walkLength, this->directIO);
     }
 
-    /* Edge2vec requires multiple iterations */
+    /*
+     * Every round starts one walk from each vertex. Edge updates are applied
+     * between rounds, so all walks of a round see the same graph.
+     * Edge2vec requires multiple iterations.
+     **/
     int iteration = model->getIter();
+    int roundNum = iteration * nodeWNum;
+    EdgeIndexType applied = 0;
+    EdgeIndexType batch = this->updateBatch;
+    if (batch <= 0)
+        batch = (this->updates.size() + roundNum - 2) / std::max(1, roundNum - 1);
+
     myrandom rand = myrandom(time(0) + mainrandom.irand(10000));
-    for (int iter = 1; iter <= iteration; iter++) {
+    for (int round = 0; round < roundNum; round++) {
+        if (round > 0 && round % nodeWNum == 0)
+            model->handleIter();
+        if (round > 0 && applied < (EdgeIndexType)this->updates.size())
+            this->applyUpdates(model, applied, batch);
 
 #pragma omp parallel for num_threads(threadNum)
-        for (long long i = 1; i < walkNum; i++) {
+        for (long long i = 0; i < vertexNum; i++) {
             int tid = omp_get_thread_num();
 
-            VertexIndexType startVertex = i % vertexNum;
-            int startState = rand.irand(model->stateNum(startVertex));
-
-            State initialState = std::make_pair(startVertex, startState);
+            VertexIndexType startVertex = i;
+            State initialState = this->startState(model, startVertex, rand);
 
             /* Create walker instance */
             Walker walker(
                 model,                  /* random walk model */
                 graph,                  /* graph pointer */
                 walkLength,             /* random walk length */
-                (int)(i % vertexNum),   /* starting vertex */
+                startVertex,            /* starting vertex */
                 initialState,
                 this->startMode,        /* initialization strategy */
-                txt[tid],             /* output file pointer */
-                this->out,              /* do we output walk sequence */
+                output,                 /* walk sequence destination, if any */
                 this->samplerManager
             );
 
@@ -140,13 +173,6 @@ void RandomWalk::runModel(RWModel *model) {
             }
             walker.walkerExecute();
         }
-
-        if (this->out && iter == iteration) {
-            for (int i = 0; i < threadNum; i++) {
-                fclose(txt[i]);
-            }
-        }
-
     }
 
     auto end = chrono::steady_clock::now();
@@ -155,19 +181,208 @@ void RandomWalk::runModel(RWModel *model) {
         << chrono::duration_cast<chrono::duration<float>>(end - begin).count()
         << " s to run" << endl;
 
-    if (this->out) {
-        cout << "merge" << endl;
-        int stat = system("cat txt/rw_* >> txt/all");
-        if (stat) {
-            cerr << stat << endl;
+    if (output != nullptr) {
+        output->close();
+        delete output;
+    }
+}
+
+/**
+ * Random initial state of a walk from `vertex`. Isolated vertices have no
+ * state but still make a walk of themselves alone, as they always did;
+ * other vertices without a state, of a type outside every metapath, start
+ * no walk.
+ **/
+State RandomWalk::startState(RWModel *model, VertexIndexType vertex, myrandom &random) {
+    int states = model->stateNum(vertex);
+    if (states == 0 && graph->getDegree()[vertex] == 0)
+        return std::make_pair(vertex, -1);
+    if (states == 0)
+        return std::make_pair(-1, 0);
+    return std::make_pair(vertex, (int)random.irand(states));
+}
+
+/**
+ * Apply the next batch of edge updates and let the model and the samplers
+ * catch up with the new graph.
+ **/
+void RandomWalk::applyUpdates(RWModel *model, EdgeIndexType &applied, EdgeIndexType batch) {
+    auto begin = chrono::steady_clock::now();
+    EdgeIndexType num = std::min(batch, (EdgeIndexType)this->updates.size() - applied);
+    std::vector<VertexIndexType> touched;
+    bool relaid = graph->applyEdgeBatch(&this->updates[applied], num, touched);
+    model->onGraphUpdate(touched, relaid);
+    this->samplerManager->onGraphUpdate(touched, relaid);
+    applied += num;
+    auto end = chrono::steady_clock::now();
+    std::cout << "\rApplied " << num << " edge updates, " << touched.size()
+              << " vertices touched" << (relaid ? ", edges laid out again" : "")
+              << ", took " << chrono::duration_cast<chrono::duration<float>>(end - begin).count()
+              << " s" << endl;
+}
+
+/**
+ * Rebuild the corpus after a graph update.
+ * Blocks whose walks never visit an endpoint of a changed edge are copied
+ * verbatim. In the other blocks each walk is kept up to its first affected
+ * vertex and the rest is walked again on the updated graph. Vertices added by
+ * the update get fresh walks.
+ **/
+void RandomWalk::runIncremental(RWModel *model) {
+    if (this->corpusPath == nullptr || this->deltaPath == nullptr) {
+        printf("Incremental walks need -prev-corpus, -delta and -corpus\n");
+        exit(1);
+    }
+    if (!strcmp(this->corpusPath, this->prevCorpusPath)) {
+        printf("-corpus must differ from -prev-corpus\n");
+        exit(1);
+    }
+    CorpusReader reader(this->prevCorpusPath);
+    if (!reader.isOpen()) {
+        printf("Cannot open corpus %s\n", this->prevCorpusPath);
+        exit(1);
+    }
+    auto begin = chrono::steady_clock::now();
+    CorpusHeader &prevHeader = reader.getHeader();
+    VertexIndexType vertexNum = graph->getNumberOfVertex();
+    VertexIndexType prevVertexNum = prevHeader.vertexNum;
+    int walkLength = prevHeader.walkLength;
+    if (prevVertexNum > vertexNum) {
+        printf("The updated graph has fewer vertices than the corpus\n");
+        exit(1);
+    }
+
+    char *affected = static_cast<char *>(calloc(vertexNum, sizeof(char)));
+    int64_t deltaNum = loadEdgeDelta(this->deltaPath, vertexNum, affected);
+
+    CorpusVertexIndex index(&reader, prevVertexNum, threadNum);
+    int64_t blockNum = reader.getBlockNum();
+    char *dirty = static_cast<char *>(calloc(blockNum, sizeof(char)));
+    int64_t affectedNum = 0;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:affectedNum) num_threads(threadNum)
+    for (VertexIndexType v = 0; v < prevVertexNum; v++) {
+        if (!affected[v]) continue;
+        affectedNum++;
+        for (const int64_t *b = index.begin(v); b != index.end(v); b++)
+            dirty[*b] = 1;
+    }
+    int64_t dirtyNum = 0;
+    for (int64_t b = 0; b < blockNum; b++)
+        dirtyNum += dirty[b];
+    std::cout << "Delta: " << deltaNum << " edges, " << affectedNum << " affected vertices, "
+              << dirtyNum << " of " << blockNum << " blocks to rewalk, index "
+              << (index.memoryBytes() >> 20) << " MB" << std::endl;
+
+    /* keep the vertex order of the previous corpus so clean blocks stay valid */
+    CorpusCodec *codec = reader.getCodec();
+    codec->extend(vertexNum);
+    CorpusHeader header = prevHeader;
+    header.vertexNum = vertexNum;
+    CorpusWalkOutput *output = new CorpusWalkOutput(
+        this->corpusPath, header, codec, threadNum, this->directIO);
+
+    int64_t maxBytes = 0;
+    for (int64_t b = 0; b < blockNum; b++)
+        maxBytes = std::max(maxBytes, (int64_t)reader.getBlockEntry(b).bytes);
+
+    long long rewalkNum = 0, rewalkSteps = 0;
+#pragma omp parallel num_threads(threadNum) reduction(+:rewalkNum, rewalkSteps)
+{
+    int tid = omp_get_thread_num();
+    myrandom random(time(0) + tid * 7919 + mainrandom.irand(10000));
+    unsigned char *raw = static_cast<unsigned char *>(
+        ParallelFileWriter::allocBuffer(ParallelFileWriter::padded(maxBytes)));
+    std::vector<unsigned char> buffer;
+    WalkBlock *block = reader.newBlock();
+    int *walk = static_cast<int *>(malloc(walkLength * sizeof(int)));
+
+#pragma omp for schedule(dynamic)
+    for (int64_t b = 0; b < blockNum; b++) {
+        CorpusBlockEntry &entry = reader.getBlockEntry(b);
+        if (!dirty[b]) {
+            if (!reader.readRaw(b, raw)) {
+                printf("Cannot read corpus block %ld\n", (long)b);
+                exit(1);
+            }
+            output->copyBlock(tid, raw, entry.bytes, entry.walkNum, index.getBlockInts(b));
+            continue;
+        }
+        if (!reader.readBlock(b, block, buffer)) {
+            printf("Cannot read corpus block %ld\n", (long)b);
+            exit(1);
         }
-        stat = system("rm txt/rw_*");
-        if (stat) {
-            cerr << stat << endl;
+        for (int pos = 0; pos < block->size; pos += block->data[pos] + 1) {
+            int length = block->data[pos];
+            int *prev = block->data + pos + 1;
+
+            /* the step leaving an affected vertex may change */
+            int start = 0;
+            while (start < length && start < walkLength - 1 && !affected[prev[start]])
+                start++;
+            if (start == length || start == walkLength - 1) {
+                output->write(tid, prev, length);
+                continue;
+            }
+
+            State state = start == 0
+                ? this->startState(model, prev[0], random)
+                : model->resumeState(prev, start);
+            Walker walker(model, graph, walkLength - start, prev[start], state,
+                          this->startMode, nullptr, this->samplerManager);
+            walker.walkerExecute();
+
+            memcpy(walk, prev, start * sizeof(int));
+            int suffix = walker.getLength();
+            if (suffix == 0) {
+                walk[start] = prev[start];
+                suffix = 1;
+            } else {
+                memcpy(walk + start, walker.getWalk(), suffix * sizeof(int));
+            }
+            output->write(tid, walk, start + suffix);
+            rewalkNum++;
+            rewalkSteps += suffix - 1;
         }
-        cout << "finish merge" << endl;
     }
-    
+
+    /* vertices added by the update */
+#pragma omp for schedule(dynamic)
+    for (long long i = 0; i < (long long)(vertexNum - prevVertexNum) * nodeWNum; i++) {
+        VertexIndexType startVertex = prevVertexNum + i / nodeWNum;
+        State initialState = this->startState(model, startVertex, random);
+        Walker walker(model, graph, walkLength, startVertex, initialState,
+                      this->startMode, output, this->samplerManager);
+        walker.walkerExecute();
+    }
+
+    free(walk);
+    free(raw);
+    delete block;
+}
+
+    auto end = chrono::steady_clock::now();
+    std::cout << "Rewalked " << rewalkNum << " of " << prevHeader.walkNum << " walks, "
+              << rewalkSteps << " steps, took "
+              << chrono::duration_cast<chrono::duration<float>>(end - begin).count()
+              << " s to run" << endl;
+
+    output->close();
+    delete output;
+    free(affected);
+    free(dirty);
+}
+
+void RandomWalk::fillCorpusHeader(CorpusHeader &header, int walkLength) {
+    int a = 0;
+    initCorpusHeader(header, this->encoding, graph->getNumberOfVertex());
+    header.walkLength = walkLength;
+    header.model = this->type;
+    if ((a = argPos(const_cast<char *>("-p"), argc, argv)) > 0)
+        header.paramP = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-q"), argc, argv)) > 0)
+        header.paramQ = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-meta"), argc, argv)) > 0)
+        strncpy(header.meta, argv[a + 1], sizeof(header.meta) - 1);
 }
 
 void RandomWalk::getArgs(int argc, char **argv) {
@@ -182,6 +397,10 @@ void RandomWalk::getArgs(int argc, char **argv) {
         this->type = FAIRWALK;
     else if ((a = argPos(const_cast<char *>("-edge2vec"), argc, argv)) > 0)
         this->type = EDGE2VEC;
+    else if ((a = argPos(const_cast<char *>("-ppr"), argc, argv)) > 0)
+        this->type = PPR;
+    else if ((a = argPos(const_cast<char *>("-temporal-walk"), argc, argv)) > 0)
+        this->type = TEMPORAL;
 
     if ((a = argPos(const_cast<char *>("-out"), argc, argv)) > 0)
         this->out = true;
@@ -193,6 +412,51 @@ void RandomWalk::getArgs(int argc, char **argv) {
         this->threadNum = atoi(argv[a + 1]);
     if ((a = argPos(const_cast<char *>("-walks"), argc, argv)) > 0)
         this->nodeWNum = atoi(argv[a + 1]);
+    this->walkLength = 0;
+    if ((a = argPos(const_cast<char *>("-length"), argc, argv)) > 0) {
+        this->walkLength = atoi(argv[a + 1]);
+        if (this->walkLength < 1) {
+            printf("-length must be at least 1\n");
+            exit(1);
+        }
+    }
+
+    this->walkPath = const_cast<char *>("txt/all");
+    if ((a = argPos(const_cast<char *>("-walkfile"), argc, argv)) > 0)
+        this->walkPath = argv[a + 1];
+    this->directIO = argPos(const_cast<char *>("-direct"), argc, argv) > 0;
+
+    this->updatePath = nullptr;
+    this->updateBatch = 0;
+    this->slack = 0.2f;
+    if ((a = argPos(const_cast<char *>("-updates"), argc, argv)) > 0)
+        this->updatePath = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-batch"), argc, argv)) > 0)
+        this->updateBatch = atoll(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-slack"), argc, argv)) > 0)
+        this->slack = atof(argv[a + 1]);
+
+    this->prevCorpusPath = nullptr;
+    this->deltaPath = nullptr;
+    if ((a = argPos(const_cast<char *>("-prev-corpus"), argc, argv)) > 0)
+        this->prevCorpusPath = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-delta"), argc, argv)) > 0)
+        this->deltaPath = argv[a + 1];
+
+    this->corpusPath = nullptr;
+    this->encoding = CORPUS_RANK;
+    if ((a = argPos(const_cast<char *>("-corpus"), argc, argv)) > 0)
+        this->corpusPath = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-encoding"), argc, argv)) > 0) {
+        if (!strcmp(argv[a + 1], "delta"))
+            this->encoding = CORPUS_DELTA;
+        else if (!strcmp(argv[a + 1], "rank"))
+            this->encoding = CORPUS_RANK;
+        else {
+            printf("Unknown corpus encoding %s\n", argv[a + 1]);
+            exit(1);
+        }
+    }
 
     if ((a = argPos(const_cast<char *>("-burnin"), argc, argv)) > 0)
         this->startMode = BURNIN;
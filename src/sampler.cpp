@@ -40,12 +40,13 @@ MemSampler::MemSampler(): Sampler() {
 void Sampler::initialize(Sampler *sampler, State state, StartMode mode, myrandom &random, bool mem) {
     int vertex = state.first;
     int offset = state.second;
-    EdgeIndexType curDegree = globGraph->getDegree()[vertex];
-    EdgeIndexType curOffset = globGraph->getOffsets()[vertex];
+    EdgeIndexType curOffset;
+    VertexIndexType curDegree;
+    randomWalkModel->candidateRange(state, curOffset, curDegree);
     
     /* Random initialization */
     if (mode == RANDOM) {
-        EdgeIndexType nextEdgeIdx = curOffset + (EdgeIndexType)(random.irand(curDegree));
+        EdgeIndexType nextEdgeIdx = randomWalkModel->proposeEdge(state, curOffset, curDegree, random);
         float nextWeight = randomWalkModel->computeWeight(
             state, nextEdgeIdx);
         int cnt = 0;
@@ -73,7 +74,7 @@ void Sampler::initialize(Sampler *sampler, State state, StartMode mode, myrandom
         float w, w1;
         EdgeIndexType nextEdgeIdx; 
         for (int iter = 0; iter < 100; iter++) {
-            nextEdgeIdx = curOffset + (EdgeIndexType)random.irand(curDegree);
+            nextEdgeIdx = randomWalkModel->proposeEdge(state, curOffset, curDegree, random);
             Sampler::getSample(sampler, state, nextEdgeIdx, random, mem);
         }
     }
@@ -92,7 +93,7 @@ void Sampler::initialize(Sampler *sampler, State state, StartMode mode, myrandom
         //float maxWeight   = randomWalkModel->computeWeight(state, maxEdge);
         float w1;
         for (int iter = 0; iter < 20; iter++) {
-            nextEdgeIdx = curOffset + (EdgeIndexType)random.irand(curDegree);
+            nextEdgeIdx = randomWalkModel->proposeEdge(state, curOffset, curDegree, random);
             w1 = randomWalkModel->computeWeight(
                 state, nextEdgeIdx);
             if (w1 > maxWeight) {
@@ -102,9 +103,10 @@ void Sampler::initialize(Sampler *sampler, State state, StartMode mode, myrandom
         }
         sampler->previousSample = maxEdge;
         if (mem) {
-            static_cast<MemSampler *>(sampler)->previousWeight - maxWeight;
+            static_cast<MemSampler *>(sampler)->previousWeight = maxWeight;
         }
     }
+    sampler->started = true;
 }
 
 EdgeIndexType Sampler::getSample(Sampler *sampler, State curState, long long candidateSample, myrandom &random, bool mem) {
@@ -149,20 +151,55 @@ SamplerManager::SamplerManager(
 
     /* allocate sampler buckets for each vertex */
     for (int vertex = 0; vertex < this->vertexNum; ++vertex) {
-        int bucketSize = model->stateNum(vertex);
+        this->samplerSet[vertex] = this->allocBucket(vertex);
+    }
+}
 
-        if (this->memWeight) {
-            this->samplerSet[vertex] = (Sampler *)(new MemSampler[bucketSize]);
-        } else {
-            this->samplerSet[vertex] = new Sampler[bucketSize];
-        }
+Sampler *SamplerManager::allocBucket(int vertex) {
+    int bucketSize = randomWalkModel->stateNum(vertex);
+    if (this->memWeight) {
+        return (Sampler *)(new MemSampler[bucketSize]);
+    } else {
+        return new Sampler[bucketSize];
+    }
+}
+
+void SamplerManager::freeBucket(int vertex) {
+    if (this->memWeight) {
+        delete[] static_cast<MemSampler *>(this->samplerSet[vertex]);
+    } else {
+        delete[] this->samplerSet[vertex];
+    }
+}
+
+Sampler *SamplerManager::getSampler(int vertex, int offset) {
+    if (this->memWeight) {
+        return static_cast<MemSampler *>(this->samplerSet[vertex]) + offset;
+    }
+    return this->samplerSet[vertex] + offset;
+}
+
+void SamplerManager::onGraphUpdate(const std::vector<VertexIndexType> &touched, bool relaid) {
+    /* the number of states follows the degree */
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < touched.size(); i++) {
+        this->freeBucket(touched[i]);
+        this->samplerSet[touched[i]] = this->allocBucket(touched[i]);
+    }
+    /* other samplers keep their state unless their edge indices moved */
+    if (!relaid) return;
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int vertex = 0; vertex < this->vertexNum; ++vertex) {
+        int bucketSize = randomWalkModel->stateNum(vertex);
+        for (int offset = 0; offset < bucketSize; offset++)
+            this->getSampler(vertex, offset)->started = false;
     }
 }
 
 EdgeIndexType SamplerManager::getNextEdge(State curState, long long candidateSample, StartMode startMode, myrandom &random, bool mem) {
     int vertex = curState.first;
     int offset = curState.second;
-    Sampler *sampler = static_cast<Sampler *>(&this->samplerSet[vertex][offset]);
+    Sampler *sampler = this->getSampler(vertex, offset);
     if (!sampler->started) {
         Sampler::initialize(
             sampler, curState, startMode, random, this->memWeight);
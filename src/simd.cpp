@@ -0,0 +1,415 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "simd.h"
+#include "utils.h"
+
+#include <immintrin.h>
+
+/*
+ * exp(x) for x in [-6, 6]: x * log2(e) splits into an integer n and a
+ * fraction f in [-0.5, 0.5], 2^f comes from a degree 5 polynomial and
+ * 2^n is added to the exponent bits.
+ **/
+#define EXP_C1 0.6931471805599453f
+#define EXP_C2 0.2402265069591007f
+#define EXP_C3 0.0555041086648216f
+#define EXP_C4 0.0096181291076285f
+#define EXP_C5 0.0013333558146428f
+
+static float dotScalar(const float *a, const float *b, int n) {
+    float sum = 0;
+    for (int c = 0; c < n; c++)
+        sum += a[c] * b[c];
+    return sum;
+}
+
+static void axpyScalar(float alpha, const float *x, float *y, int n) {
+    for (int c = 0; c < n; c++)
+        y[c] += alpha * x[c];
+}
+
+static void sigmoidScalar(float *x, int n) {
+    for (int c = 0; c < n; c++) {
+        if (x[c] > SIGMOID_BOUND) x[c] = 1;
+        else if (x[c] < -SIGMOID_BOUND) x[c] = 0;
+        else x[c] = 1 / (1 + expf(-x[c]));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static float dotAvx2(const float *a, const float *b, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int c = 0;
+    for (; c + 16 <= n; c += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + c), _mm256_loadu_ps(b + c), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + c + 8), _mm256_loadu_ps(b + c + 8), acc1);
+    }
+    for (; c + 8 <= n; c += 8)
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + c), _mm256_loadu_ps(b + c), acc0);
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    float sum = _mm_cvtss_f32(half);
+    for (; c < n; c++)
+        sum += a[c] * b[c];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpyAvx2(float alpha, const float *x, float *y, int n) {
+    __m256 a = _mm256_set1_ps(alpha);
+    int c = 0;
+    for (; c + 8 <= n; c += 8)
+        _mm256_storeu_ps(y + c, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + c), _mm256_loadu_ps(y + c)));
+    for (; c < n; c++)
+        y[c] += alpha * x[c];
+}
+
+__attribute__((target("avx2,fma")))
+static __m256 sigmoid8Avx2(__m256 x) {
+    const __m256 bound = _mm256_set1_ps(SIGMOID_BOUND);
+    __m256 v = _mm256_min_ps(_mm256_max_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), bound)), bound);
+    /* exp(-v) */
+    __m256 t = _mm256_mul_ps(v, _mm256_set1_ps(-1.4426950408889634f));
+    __m256 r = _mm256_round_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 f = _mm256_sub_ps(t, r);
+    __m256 p = _mm256_set1_ps(EXP_C5);
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP_C4));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP_C3));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP_C2));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP_C1));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+    __m256i bits = _mm256_slli_epi32(_mm256_cvtps_epi32(r), 23);
+    __m256 e = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), bits));
+    __m256 s = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+    /* saturate like fast_sigmoid */
+    s = _mm256_blendv_ps(s, _mm256_set1_ps(1.0f), _mm256_cmp_ps(x, bound, _CMP_GT_OQ));
+    s = _mm256_blendv_ps(s, _mm256_setzero_ps(),
+        _mm256_cmp_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), bound), _CMP_LT_OQ));
+    return s;
+}
+
+__attribute__((target("avx2,fma")))
+static void sigmoidAvx2(float *x, int n) {
+    int c = 0;
+    for (; c + 8 <= n; c += 8)
+        _mm256_storeu_ps(x + c, sigmoid8Avx2(_mm256_loadu_ps(x + c)));
+    if (c < n) {
+        float tail[8] = {0};
+        for (int k = 0; c + k < n; k++) tail[k] = x[c + k];
+        _mm256_storeu_ps(tail, sigmoid8Avx2(_mm256_loadu_ps(tail)));
+        for (int k = 0; c + k < n; k++) x[c + k] = tail[k];
+    }
+}
+
+__attribute__((target("avx512f")))
+static float dotAvx512(const float *a, const float *b, int n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int c = 0;
+    for (; c + 32 <= n; c += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + c), _mm512_loadu_ps(b + c), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + c + 16), _mm512_loadu_ps(b + c + 16), acc1);
+    }
+    for (; c + 16 <= n; c += 16)
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + c), _mm512_loadu_ps(b + c), acc0);
+    if (c < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - c)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + c),
+                               _mm512_maskz_loadu_ps(mask, b + c), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+static void axpyAvx512(float alpha, const float *x, float *y, int n) {
+    __m512 a = _mm512_set1_ps(alpha);
+    int c = 0;
+    for (; c + 16 <= n; c += 16)
+        _mm512_storeu_ps(y + c, _mm512_fmadd_ps(a, _mm512_loadu_ps(x + c), _mm512_loadu_ps(y + c)));
+    if (c < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - c)) - 1);
+        __m512 r = _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask, x + c),
+                                   _mm512_maskz_loadu_ps(mask, y + c));
+        _mm512_mask_storeu_ps(y + c, mask, r);
+    }
+}
+
+__attribute__((target("avx512f")))
+static __m512 sigmoid16Avx512(__m512 x) {
+    const __m512 bound = _mm512_set1_ps(SIGMOID_BOUND);
+    const __m512 negBound = _mm512_set1_ps(-SIGMOID_BOUND);
+    __m512 v = _mm512_min_ps(_mm512_max_ps(x, negBound), bound);
+    __m512 t = _mm512_mul_ps(v, _mm512_set1_ps(-1.4426950408889634f));
+    __m512 r = _mm512_roundscale_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 f = _mm512_sub_ps(t, r);
+    __m512 p = _mm512_set1_ps(EXP_C5);
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(EXP_C4));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(EXP_C3));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(EXP_C2));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(EXP_C1));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(1.0f));
+    /* p * 2^r */
+    __m512 e = _mm512_scalef_ps(p, r);
+    __m512 s = _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_add_ps(_mm512_set1_ps(1.0f), e));
+    s = _mm512_mask_mov_ps(s, _mm512_cmp_ps_mask(x, bound, _CMP_GT_OQ), _mm512_set1_ps(1.0f));
+    s = _mm512_mask_mov_ps(s, _mm512_cmp_ps_mask(x, negBound, _CMP_LT_OQ), _mm512_setzero_ps());
+    return s;
+}
+
+__attribute__((target("avx512f")))
+static void sigmoidAvx512(float *x, int n) {
+    int c = 0;
+    for (; c + 16 <= n; c += 16)
+        _mm512_storeu_ps(x + c, sigmoid16Avx512(_mm512_loadu_ps(x + c)));
+    if (c < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - c)) - 1);
+        _mm512_mask_storeu_ps(x + c, mask, sigmoid16Avx512(_mm512_maskz_loadu_ps(mask, x + c)));
+    }
+}
+
+static const SimdKernels scalarKernels = {"scalar", dotScalar, axpyScalar, sigmoidScalar};
+static const SimdKernels avx2Kernels = {"avx2", dotAvx2, axpyAvx2, sigmoidAvx2};
+static const SimdKernels avx512Kernels = {"avx512", dotAvx512, axpyAvx512, sigmoidAvx512};
+
+SimdKernels simd = scalarKernels;
+
+bool initSimd(const char *force) {
+    __builtin_cpu_init();
+    bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    bool hasAvx512 = __builtin_cpu_supports("avx512f");
+    if (force == nullptr) {
+        simd = hasAvx512 ? avx512Kernels : hasAvx2 ? avx2Kernels : scalarKernels;
+        return true;
+    }
+    if (!strcmp(force, "scalar"))
+        simd = scalarKernels;
+    else if (!strcmp(force, "avx2") && hasAvx2)
+        simd = avx2Kernels;
+    else if (!strcmp(force, "avx512") && hasAvx512)
+        simd = avx512Kernels;
+    else
+        return false;
+    return true;
+}
+
+bool parsePrecision(const char *name, Precision &precision) {
+    if (!strcmp(name, "fp32"))
+        precision = PRECISION_FP32;
+    else if (!strcmp(name, "bf16"))
+        precision = PRECISION_BF16;
+    else if (!strcmp(name, "fp16"))
+        precision = PRECISION_FP16;
+    else
+        return false;
+    return true;
+}
+
+const char *precisionName(Precision precision) {
+    switch (precision) {
+        case PRECISION_BF16: return "bf16";
+        case PRECISION_FP16: return "fp16";
+        default: return "fp32";
+    }
+}
+
+int precisionBytes(Precision precision) {
+    return precision == PRECISION_FP32 ? 4 : 2;
+}
+
+static inline uint32_t floatBits(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static inline float bitsFloat(uint32_t bits) {
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/* IEEE half precision, round to nearest even, overflow to infinity */
+static uint16_t halfFromFloat(float x) {
+    uint32_t bits = floatBits(x);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7FFFFFFF;
+    if (absBits >= 0x7F800000)      /* inf, nan */
+        return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0);
+    if (absBits >= 0x477FF000)      /* rounds above 65504 */
+        return sign | 0x7C00;
+    if (absBits < 0x38800000) {     /* subnormal or zero */
+        float scaled = bitsFloat(absBits) * 16777216.0f;   /* 2^24 */
+        return sign | (uint16_t)lrintf(scaled);
+    }
+    uint32_t mant = absBits + 0xFFF + ((absBits >> 13) & 1);
+    return sign | (uint16_t)((mant - 0x38000000) >> 13);
+}
+
+static float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F;
+    uint32_t mant = h & 0x3FF;
+    if (exp == 0)
+        return bitsFloat(sign) + (sign ? -1.0f : 1.0f) * mant / 16777216.0f;
+    if (exp == 31)
+        return bitsFloat(sign | 0x7F800000 | (mant << 13));
+    return bitsFloat(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+/*
+ * AVX2 + F16C conversions, 8 values at a time. Stochastic rounding adds
+ * random bits below the last bit kept and truncates: 16 bits for bf16,
+ * 13 bits for fp16 (exact for normal fp16 values, slightly coarse for
+ * subnormal ones).
+ **/
+__attribute__((target("avx2,f16c")))
+static inline __m256i noise8(myrandom &random, int mask) {
+    __m128i bits = _mm_set_epi64x((long long)random.lrand(), (long long)random.lrand());
+    return _mm256_and_si256(_mm256_cvtepu16_epi32(bits), _mm256_set1_epi32(mask));
+}
+
+__attribute__((target("avx2,f16c")))
+static inline __m128i narrow8(__m256i v) {
+    /* low 16 bits of 8 lanes, values being below 2^16 */
+    __m256i packed = _mm256_packus_epi32(v, v);
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0xD8));
+}
+
+__attribute__((target("avx2,f16c")))
+static void loadRowAvx2(Precision precision, const uint16_t *src, float *dst, int n) {
+    int c = 0;
+    for (; c + 8 <= n; c += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i *)(src + c));
+        __m256 f = precision == PRECISION_BF16
+            ? _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16))
+            : _mm256_cvtph_ps(h);
+        _mm256_storeu_ps(dst + c, f);
+    }
+    for (; c < n; c++)
+        dst[c] = precision == PRECISION_BF16 ? bitsFloat((uint32_t)src[c] << 16) : halfToFloat(src[c]);
+}
+
+__attribute__((target("avx2,f16c")))
+static int storeRowAvx2(Precision precision, const float *src, uint16_t *dst, int n, myrandom *random) {
+    int c = 0;
+    for (; c + 8 <= n; c += 8) {
+        __m256i bits = _mm256_castps_si256(_mm256_loadu_ps(src + c));
+        __m128i h;
+        if (precision == PRECISION_BF16) {
+            __m256i round = random != nullptr ? noise8(*random, 0xFFFF)
+                : _mm256_add_epi32(_mm256_set1_epi32(0x7FFF),
+                    _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1)));
+            h = narrow8(_mm256_srli_epi32(_mm256_add_epi32(bits, round), 16));
+        } else if (random != nullptr) {
+            bits = _mm256_add_epi32(bits, noise8(*random, 0x1FFF));
+            h = _mm256_cvtps_ph(_mm256_castsi256_ps(bits), _MM_FROUND_TO_ZERO);
+        } else {
+            h = _mm256_cvtps_ph(_mm256_castsi256_ps(bits), _MM_FROUND_TO_NEAREST_INT);
+        }
+        _mm_storeu_si128((__m128i *)(dst + c), h);
+    }
+    return c;
+}
+
+static bool hasAvx2F16c() {
+    static int supported = -1;
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c") ? 1 : 0;
+    }
+    return supported;
+}
+
+void loadRow(Precision precision, const void *src, float *dst, int n) {
+    if (precision == PRECISION_FP32) {
+        memcpy(dst, src, n * sizeof(float));
+        return;
+    }
+    const uint16_t *in = static_cast<const uint16_t *>(src);
+    if (hasAvx2F16c()) {
+        loadRowAvx2(precision, in, dst, n);
+    } else if (precision == PRECISION_BF16) {
+        for (int c = 0; c < n; c++)
+            dst[c] = bitsFloat((uint32_t)in[c] << 16);
+    } else {
+        for (int c = 0; c < n; c++)
+            dst[c] = halfToFloat(in[c]);
+    }
+}
+
+void storeRow(Precision precision, const float *src, void *dst, int n, myrandom *random) {
+    if (precision == PRECISION_FP32) {
+        memcpy(dst, src, n * sizeof(float));
+        return;
+    }
+    uint16_t *out = static_cast<uint16_t *>(dst);
+    /* the vector path leaves the tail to the scalar code below */
+    if (hasAvx2F16c()) {
+        int done = storeRowAvx2(precision, src, out, n, random);
+        src += done;
+        out += done;
+        n -= done;
+    }
+    if (precision == PRECISION_BF16) {
+        if (random != nullptr) {
+            /* add 16 random bits below the kept ones, then truncate */
+            uint64_t noise = 0;
+            for (int c = 0; c < n; c++) {
+                if ((c & 3) == 0) noise = random->lrand();
+                uint32_t bits = floatBits(src[c]);
+                out[c] = (bits + (uint32_t)(noise & 0xFFFF)) >> 16;
+                noise >>= 16;
+            }
+        } else {
+            for (int c = 0; c < n; c++) {
+                uint32_t bits = floatBits(src[c]);
+                out[c] = (bits + 0x7FFF + ((bits >> 16) & 1)) >> 16;
+            }
+        }
+        return;
+    }
+    if (random != nullptr) {
+        /* round the magnitude up with the probability of its remainder */
+        for (int c = 0; c < n; c++) {
+            float x = src[c];
+            uint16_t h = halfFromFloat(x);
+            float rounded = halfToFloat(h);
+            if (rounded == x || (h & 0x7C00) == 0x7C00) {
+                out[c] = h;
+                continue;
+            }
+            /* neighbours of x in fp16, below and above its magnitude */
+            uint16_t lo = fabsf(rounded) < fabsf(x) ? h : h - 1;
+            uint16_t hi = lo + 1;
+            float loAbs = fabsf(halfToFloat(lo)), hiAbs = fabsf(halfToFloat(hi));
+            float p = (fabsf(x) - loAbs) / (hiAbs - loAbs);
+            out[c] = random->drand() < p ? hi : lo;
+        }
+    } else {
+        for (int c = 0; c < n; c++)
+            out[c] = halfFromFloat(src[c]);
+    }
+}
@@ -24,26 +24,56 @@
 
 #include "train.h"
 
+#define CACHE_LINE 64
+
 Train::Train(LSGraph *graph, int argc, char **argv) {
     this->nv = graph->getNumberOfVertex();
-    threadNum = 1;
+    this->graph = graph;
+    this->queue = nullptr;
+    threadNum = 16;
     
+    this->getArgs(argc, argv);
     init();
+    this->run();
+}
+
+Train::Train(LSGraph *graph, int argc, char **argv, WalkQueue *_queue) {
+    this->nv = graph->getNumberOfVertex();
+    this->graph = graph;
+    this->queue = _queue;
+    threadNum = 16;
+
     this->getArgs(argc, argv);
-    char inputPath[100];
+    init();
+    this->run();
+}
 
-    for (int i = 0; i < threadNum; i++) {
-        sprintf(inputPath, "./walks/rw_out_%d", i);
-        files[i] = fopen(inputPath, "rb");
-    } 
+void Train::run() {
     auto begin = chrono::steady_clock::now();
-    this->trainSG();
+    if (this->checkpoint_path != nullptr && (this->queue != nullptr || this->parts.partNum > 1)) {
+        /* neither streamed walks nor pair buckets outlive the process */
+        printf("-checkpoint needs a walk corpus and cannot be combined with -stream or -partitions\n");
+        exit(1);
+    }
+    if (this->parts.partNum > 1) {
+        this->bucketPairs();
+        this->trainBuckets();
+    } else if (this->queue != nullptr)
+        this->trainStream();
+    else
+        this->trainSG();
     
     auto end = chrono::steady_clock::now();
+    for (NegTable *table : this->retiredNeg)
+        this->freeNegTable(table);
+    this->retiredNeg.clear();
+    float seconds = chrono::duration_cast<chrono::duration<float>>(end - begin).count();
     cout 
          << "\rEmbedding Training took "
-         << chrono::duration_cast<chrono::duration<float>>(end - begin).count()
-         << " s to run" << endl;
+         << seconds
+         << " s to run, " << this->pairs << " pairs, "
+         << fixed << setprecision(0) << (this->pairs - this->resumedPairs) / std::max(seconds, 1e-6f)
+         << " pairs/s" << endl;
     if (this->out_path != nullptr) {
         cout << "Write embedding file" << endl;
         this->write_file();
@@ -64,143 +94,1073 @@ aligned_malloc(size_t size,
 }
 
 void Train::init() {
-    initial_lr = 0.025f;
-    window_size = 10;
-    n_hidden = 128;
-    n_walks = 10;
     step = 0;
-    walk_length = 80;
-    this->out_path = (char *)malloc(100 * sizeof(char));
+    pairs = 0;
+    resumedPairs = 0;
 
-    // each thread handles one walking file
-    
-    // vertex embedding
+    this->dataBytes = (long long)n_hidden * precisionBytes(precision);
+    this->rowBytes = dataBytes;
+    if (padRows) {
+        /* no two rows share a line, so updates to one never invalidate another */
+        this->rowBytes = (dataBytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    }
+    cout << "Embedding tables in " << precisionName(precision) << ", "
+         << ((2 * ((long long)nv + 1) * rowBytes) >> 20) << " MB" << endl;
+
+    if (parts.partNum > 1) {
+        this->initPartitions();
+    } else {
+        this->wVtx = static_cast<char *>(
+            aligned_malloc((nv + 1) * rowBytes, DEFAULT_ALIGN));
+        // context embedding, zero has the same bits in every precision
+        this->wCtx = static_cast<char *>(
+            aligned_malloc((nv + 1) * rowBytes, DEFAULT_ALIGN));
+        memset(wCtx, 0, (nv + 1) * rowBytes);
+    }
 
-    this->wVtx = static_cast<float *>(
-        aligned_malloc((nv + 1) * n_hidden * sizeof(float), DEFAULT_ALIGN));
+    // vertex embedding
     myrandom random(time(nullptr));  
-    for (long long i = 0; i < (nv + 1) * n_hidden; i++)
-        wVtx[i] = (random.drand() - 0.5) / n_hidden;
-    // context embedding
-    this->wCtx = static_cast<float *>(
-        aligned_malloc((nv + 1) * n_hidden * sizeof(float), DEFAULT_ALIGN));
-    memset(wCtx, 0, (nv + 1) * n_hidden * sizeof(float));
+    std::vector<float> initRow(n_hidden);
+    for (long long i = 0; i < nv + 1; i++) {
+        for (int c = 0; c < n_hidden; c++)
+            initRow[c] = (random.drand() - 0.5) / n_hidden;
+        storeRow(precision, initRow.data(), row(wVtx, i), n_hidden, nullptr);
+        /* written out partition by partition so the init stays in bounds */
+        if (parts.partNum > 1 && (i + 1) % parts.partSize == 0)
+            vtxTable->evict(parts.partOf(i));
+    }
+    this->affected = nullptr;
+    if (this->init_emb_path != nullptr)
+        this->warmStart();
 
     init_sigmoid_table();
+    if (!initSimd(this->simd_name)) {
+        printf("Kernel set %s is unknown or not supported by this CPU\n", this->simd_name);
+        exit(1);
+    }
+    cout << "Using " << simd.name << " kernels" << endl;
+    this->initNegTable();
+    this->initSubsample();
+    this->initHubs();
+}
+
+void Train::initHubs() {
+    this->hubIndex = nullptr;
+    this->hubPart = -1;
+    this->hubNum = std::min(hubNum, nv);
+    if (hubNum <= 0) return;
+    int *degrees = graph->getDegree();
+    std::vector<int> order(nv);
+    for (int v = 0; v < nv; v++)
+        order[v] = v;
+    std::nth_element(order.begin(), order.begin() + hubNum - 1, order.end(),
+        [degrees](int x, int y) { return degrees[x] > degrees[y]; });
+    this->hubs = static_cast<long long *>(malloc(hubNum * sizeof(long long)));
+    this->hubIndex = static_cast<int *>(malloc((nv + 1) * sizeof(int)));
+    for (int r = 0; r <= nv; r++)
+        this->hubIndex[r] = -1;
+    for (int h = 0; h < hubNum; h++) {
+        long long r = parts.partNum > 1 ? parts.slot[order[h]] : order[h];
+        this->hubs[h] = r;
+        this->hubIndex[r] = h;
+    }
+    cout << "Replicating " << hubNum << " hub rows per thread, down to degree "
+         << degrees[order[hubNum - 1]] << endl;
+}
+
+/*
+ * Rows of the vertices in `-init-emb` replace the random ones. Vertices it
+ * lacks start from the mean of the neighbors it has, so that they begin in
+ * the previous space, and count as affected along with the endpoints of
+ * the `-delta` edges.
+ **/
+void Train::warmStart() {
+    PreviousEmbedding prev(this->init_emb_path);
+    if (prev.dim != n_hidden) {
+        printf("%s has dimension %d, not %d\n", this->init_emb_path, prev.dim, n_hidden);
+        exit(1);
+    }
+    if (prev.vertexNum > nv) {
+        printf("%s has %lld vertices, the graph only %d\n", this->init_emb_path, prev.vertexNum, nv);
+        exit(1);
+    }
+    if (this->delta_path != nullptr) {
+        this->affected = static_cast<char *>(calloc(nv, sizeof(char)));
+        loadEdgeDelta(this->delta_path, nv, this->affected);
+    }
+
+    /*
+     * without a context table the vertex rows stand in for it, the two
+     * being close for undirected walks, which trains better than zeros
+     **/
+    auto ctxRow = [&prev](long long v) { return prev.hasContext() ? prev.ctxRow(v) : prev.vtxRow(v); };
+    EdgeIndexType *offsets = graph->getOffsets();
+    int *edges = graph->getEdges();
+    /* slack past the degree of a vertex holds no edges */
+    int *degrees = graph->getDegree();
+    std::vector<float> vtxMean(n_hidden), ctxMean(n_hidden);
+    long long loaded = 0, fromNeighbors = 0;
+    for (long long r = 0; r < nv; r++) {
+        int v = parts.partNum > 1 ? parts.vertex[r] : r;
+        if (prev.has(v)) {
+            storeRow(precision, prev.vtxRow(v), row(wVtx, r), n_hidden, nullptr);
+            storeRow(precision, ctxRow(v), row(wCtx, r), n_hidden, nullptr);
+            loaded++;
+        } else {
+            if (this->affected != nullptr)
+                this->affected[v] = 1;
+            int count = 0;
+            std::fill(vtxMean.begin(), vtxMean.end(), 0.f);
+            std::fill(ctxMean.begin(), ctxMean.end(), 0.f);
+            for (EdgeIndexType e = offsets[v]; e < offsets[v] + degrees[v]; e++) {
+                int u = edges[e];
+                if (!prev.has(u)) continue;
+                for (int c = 0; c < n_hidden; c++) {
+                    vtxMean[c] += prev.vtxRow(u)[c];
+                    ctxMean[c] += ctxRow(u)[c];
+                }
+                count++;
+            }
+            if (count > 0) {
+                for (int c = 0; c < n_hidden; c++) {
+                    vtxMean[c] /= count;
+                    ctxMean[c] /= count;
+                }
+                storeRow(precision, vtxMean.data(), row(wVtx, r), n_hidden, nullptr);
+                storeRow(precision, ctxMean.data(), row(wCtx, r), n_hidden, nullptr);
+                fromNeighbors++;
+            }
+        }
+        if (parts.partNum > 1 && (r + 1) % parts.partSize == 0) {
+            vtxTable->evict(parts.partOf(r));
+            ctxTable->evict(parts.partOf(r));
+        }
+    }
+    cout << "Warm start from " << this->init_emb_path << ": " << loaded << " vertices loaded"
+         << (prev.hasContext() ? " with context rows, " : ", ") << fromNeighbors
+         << " from their neighbors" << endl;
+    if (this->affected != nullptr) {
+        long long affectedNum = 0;
+        for (int v = 0; v < nv; v++)
+            affectedNum += this->affected[v];
+        cout << "Training only walks through " << affectedNum << " affected vertices" << endl;
+    }
+}
+
+/* walks without an affected vertex are left out of a warm start with `-delta` */
+bool Train::touchesAffected(const int *walk, int length) {
+    for (int i = 0; i < length; i++) {
+        if (walk[i] < 0) break;
+        if (walk[i] < nv && this->affected[walk[i]]) return true;
+    }
+    return false;
+}
+
+void Train::initPartitions() {
+    parts.assign(nv, parts.partNum);
+    if (this->swap_dir == nullptr) {
+        const char *tmpdir = getenv("TMPDIR");
+        this->swap_dir = const_cast<char *>(tmpdir != nullptr ? tmpdir : "/tmp");
+    }
+    cout << parts.partNum << " partitions of " << ((parts.partSize * rowBytes) >> 20)
+         << " MB per table, swapped to " << this->swap_dir << endl;
+    this->vtxTable = new SwapTable(swap_dir, nv + 1, rowBytes, parts.partSize);
+    this->ctxTable = new SwapTable(swap_dir, nv + 1, rowBytes, parts.partSize);
+    this->wVtx = vtxTable->data();
+    this->wCtx = ctxTable->data();
+    this->buckets = new PairBuckets(swap_dir, parts.partNum);
+}
+
+void Train::initNegTable() {
+    this->negTable = this->buildNegTable(nullptr);
+    this->visits = nullptr;
+    this->visitTotal = 0;
+    this->rebuilding = false;
+    /* the first rebuild once vertices are visited once on average */
+    this->nextRebuild = nv;
+    if (this->negFromWalks) {
+        this->visits = static_cast<unsigned int *>(calloc(nv, sizeof(unsigned int)));
+        cout << "Negatives from walk visits, starting from degrees" << endl;
+    }
+}
+
+/*
+ * `counts` of every vertex, degrees if null
+ **/
+Train::NegTable *Train::buildNegTable(const unsigned int *counts) {
+    int *degrees = graph->getDegree();
+    const int *vertexOf = parts.partNum > 1 ? parts.vertex.data() : nullptr;
+    std::vector<float> weights(nv);
+#pragma omp parallel for num_threads(threadNum)
+    for (int r = 0; r < nv; r++) {
+        int v = vertexOf != nullptr ? vertexOf[r] : r;
+        weights[r] = pow(counts != nullptr ? counts[v] : degrees[v], 0.75);
+    }
+    NegTable *table = new NegTable;
+    table->prob = static_cast<float *>(malloc(nv * sizeof(float)));
+    table->alias = static_cast<int *>(malloc(nv * sizeof(int)));
+    for (int p = 0; p < std::max(parts.partNum, 1); p++) {
+        long long begin = this->partBegin(p), end = this->partEnd(p);
+        if (end > begin)
+            buildAliasTable(&weights[begin], end - begin, table->prob + begin, table->alias + begin);
+    }
+    return table;
+}
+
+void Train::freeNegTable(NegTable *table) {
+    free(table->prob);
+    free(table->alias);
+    delete table;
+}
+
+/*
+ * Threads count the walks they train, the one passing the threshold
+ * rebuilds the tables while the others go on with the old ones.
+ **/
+void Train::countVisits(const int *walk, int length) {
+    for (int i = 0; i < length; i++) {
+        int v = walk[i];
+        if (v < 0 || v >= nv) continue;
+#pragma omp atomic
+        this->visits[v]++;
+    }
+    long long total = (this->visitTotal += length);
+    if (total < this->nextRebuild || this->rebuilding.exchange(true)) return;
+    if (total >= this->nextRebuild) {
+        NegTable *table = this->buildNegTable(this->visits);
+        this->retiredNeg.push_back(this->negTable.exchange(table));
+        this->nextRebuild = 2 * total;
+    }
+    this->rebuilding = false;
+}
+
+/*
+ * One random number per draw, 40 bits for the slot and 24 for the coin.
+ **/
+long long Train::nextNegative(Batch *batch, int part, myrandom &random) {
+    NegTable *table = this->negTable.load();
+    if (batch->negLeft == 0 || batch->negFrom != table || batch->negPart != part) {
+        long long begin = this->partBegin(part), span = this->partEnd(part) - begin;
+        for (int i = 0; i < negBatch; i++) {
+            uint64_t bits = random.lrand();
+            long long k = begin + (long long)((bits >> 24) % span);
+            float coin = (bits & 0xFFFFFF) * (1.0f / 16777216.0f);
+            batch->negBuf[i] = coin < table->prob[k] ? k : begin + table->alias[k];
+        }
+        batch->negLeft = negBatch;
+        batch->negFrom = table;
+        batch->negPart = part;
+    }
+    return batch->negBuf[--batch->negLeft];
+}
+
+/*
+ * keep probability of every vertex for the subsampling threshold `sample`,
+ * word2vec's formula with the degree share as frequency
+ **/
+void Train::initSubsample() {
+    this->keepProb = nullptr;
+    if (this->sample <= 0) return;
+    int *degrees = graph->getDegree();
+    double total = 0;
+    for (int v = 0; v < nv; v++)
+        total += degrees[v];
+    if (total == 0) return;
+    this->keepProb = static_cast<float *>(malloc(nv * sizeof(float)));
+    double threshold = this->sample * total;
+    for (int v = 0; v < nv; v++) {
+        double count = degrees[v];
+        double keep = count == 0 ? 1.0 : (sqrt(count / threshold) + 1) * threshold / count;
+        this->keepProb[v] = std::min(1.0, keep);
+    }
+}
+
+int Train::subsampleWalk(const int *walk, int length, int *kept, myrandom &random) {
+    int num = 0;
+    for (int i = 0; i < length; i++) {
+        int v = walk[i];
+        if (v < 0 || v >= nv) continue;
+        if (this->keepProb[v] < 1.0f && this->keepProb[v] < random.drand()) continue;
+        kept[num++] = v;
+    }
+    return num;
+}
+
+Train::Batch *Train::newBatch() {
+    int inMax = 2 * window_size, outMax = negative + 1;
+    Batch *batch = new Batch;
+    batch->inIdx = static_cast<long long *>(malloc(inMax * sizeof(long long)));
+    batch->outIdx = static_cast<long long *>(malloc(outMax * sizeof(long long)));
+    batch->inRows = static_cast<float *>(
+        aligned_malloc(inMax * n_hidden * sizeof(float), DEFAULT_ALIGN));
+    batch->inGrad = static_cast<float *>(
+        aligned_malloc(inMax * n_hidden * sizeof(float), DEFAULT_ALIGN));
+    batch->outRows = static_cast<float *>(
+        aligned_malloc(outMax * n_hidden * sizeof(float), DEFAULT_ALIGN));
+    batch->outGrad = static_cast<float *>(
+        aligned_malloc(outMax * n_hidden * sizeof(float), DEFAULT_ALIGN));
+    batch->err = static_cast<float *>(
+        aligned_malloc(inMax * outMax * sizeof(float), DEFAULT_ALIGN));
+    batch->hubRows = nullptr;
+    batch->hubBase = nullptr;
+    batch->sinceSync = 0;
+    batch->negBuf = static_cast<int *>(malloc(negBatch * sizeof(int)));
+    batch->negLeft = 0;
+    batch->negPart = -1;
+    batch->negFrom = nullptr;
+    if (hubNum > 0) {
+        batch->hubRows = static_cast<float *>(
+            aligned_malloc((long long)hubNum * n_hidden * sizeof(float), DEFAULT_ALIGN));
+        batch->hubBase = static_cast<float *>(
+            aligned_malloc((long long)hubNum * n_hidden * sizeof(float), DEFAULT_ALIGN));
+        this->loadHubs(batch);
+    }
+    return batch;
+}
+
+/* replicas of the resident hubs, fresh from the shared rows */
+void Train::loadHubs(Batch *batch) {
+    for (int h = 0; h < hubNum; h++) {
+        if (!this->hubResident(h)) continue;
+        loadRow(precision, row(wCtx, hubs[h]), &batch->hubBase[(long long)h * n_hidden], n_hidden);
+        memcpy(&batch->hubRows[(long long)h * n_hidden], &batch->hubBase[(long long)h * n_hidden],
+               n_hidden * sizeof(float));
+    }
+}
+
+void Train::freeBatch(Batch *batch) {
+    free(batch->inIdx);
+    free(batch->outIdx);
+    free(batch->inRows);
+    free(batch->inGrad);
+    free(batch->outRows);
+    free(batch->outGrad);
+    free(batch->err);
+    free(batch->hubRows);
+    free(batch->hubBase);
+    free(batch->negBuf);
+    delete batch;
+}
+
+/*
+ * One pSGNS step: scores = in * out^T, err = (label - sigmoid) * lr with
+ * label 1 for the first output row only, then in += err * out and
+ * out += err^T * in, both from the rows as gathered. The gradients are
+ * added back to the shared matrices, lock free as in word2vec.
+ **/
+void Train::trainBatch(Batch *batch, int inNum, int outNum, float lr, myrandom &random) {
+    int d = n_hidden;
+    for (int i = 0; i < inNum; i++)
+        loadRow(precision, row(wVtx, batch->inIdx[i]), &batch->inRows[i * d], d);
+    for (int k = 0; k < outNum; k++) {
+        int h = this->hubOf(batch->outIdx[k]);
+        if (h >= 0)
+            memcpy(&batch->outRows[k * d], &batch->hubRows[(long long)h * d], d * sizeof(float));
+        else
+            loadRow(precision, row(wCtx, batch->outIdx[k]), &batch->outRows[k * d], d);
+    }
+
+    for (int i = 0; i < inNum; i++) {
+        for (int k = 0; k < outNum; k++)
+            batch->err[i * outNum + k] = simd.dot(&batch->inRows[i * d], &batch->outRows[k * d], d);
+    }
+    simd.sigmoid(batch->err, inNum * outNum);
+    for (int i = 0; i < inNum; i++) {
+        for (int k = 0; k < outNum; k++)
+            batch->err[i * outNum + k] = ((k == 0) - batch->err[i * outNum + k]) * lr;
+    }
+
+    for (int i = 0; i < inNum; i++) {
+        float *grad = &batch->inGrad[i * d];
+        memset(grad, 0, d * sizeof(float));
+        for (int k = 0; k < outNum; k++)
+            simd.axpy(batch->err[i * outNum + k], &batch->outRows[k * d], grad, d);
+    }
+    for (int k = 0; k < outNum; k++) {
+        float *grad = &batch->outGrad[k * d];
+        memset(grad, 0, d * sizeof(float));
+        for (int i = 0; i < inNum; i++)
+            simd.axpy(batch->err[i * outNum + k], &batch->inRows[i * d], grad, d);
+    }
+
+    /* the gathered rows are no longer needed and serve as scratch */
+    for (int i = 0; i < inNum; i++)
+        this->addToRow(wVtx, batch->inIdx[i], &batch->inGrad[i * d], &batch->inRows[i * d], random);
+    for (int k = 0; k < outNum; k++) {
+        int h = this->hubOf(batch->outIdx[k]);
+        if (h >= 0)
+            simd.axpy(1.0f, &batch->outGrad[k * d], &batch->hubRows[(long long)h * d], d);
+        else
+            this->addToRow(wCtx, batch->outIdx[k], &batch->outGrad[k * d], &batch->outRows[k * d], random);
+    }
+    if (hubNum > 0 && ++batch->sinceSync >= hubSync)
+        this->syncHubs(batch, random);
 }
 
-inline void Train::update( // update the embedding, putting w_t gradient in w_t_cache
-    float *w_s, float *w_t, float *w_t_cache, float lr, const int label) {
-    float score = 0; // score = dot(w_s, w_t)
-    AVX_LOOP
-    for (int c = 0; c < n_hidden; c++)
-        score += w_s[c] * w_t[c];
-    score = (label - fast_sigmoid(score)) * lr;
-    AVX_LOOP
-    for (int c = 0; c < n_hidden; c++)
-        w_t_cache[c] += score * w_s[c]; // w_t gradient
-    AVX_LOOP
-    for (int c = 0; c < n_hidden; c++)
-        w_s[c] += score * w_t[c]; // w_s gradient
+/*
+ * replica - base is what this thread learned since the last merge. The
+ * shared row is updated lock free like any other, the merge being rare
+ * enough for collisions not to matter.
+ **/
+void Train::syncHubs(Batch *batch, myrandom &random) {
+    int d = n_hidden;
+    float *scratch = batch->inGrad;
+    for (int h = 0; h < hubNum; h++) {
+        /* the others were merged before their partition was evicted */
+        if (!this->hubResident(h)) continue;
+        float *replica = &batch->hubRows[(long long)h * d];
+        float *base = &batch->hubBase[(long long)h * d];
+        char *shared = row(wCtx, hubs[h]);
+        loadRow(precision, shared, scratch, d);
+        simd.axpy(1.0f, replica, scratch, d);
+        simd.axpy(-1.0f, base, scratch, d);
+        storeRow(precision, scratch, shared, d, stochastic ? &random : nullptr);
+        /* read back, so the rounding of reduced precision is not counted as learned */
+        loadRow(precision, shared, base, d);
+        memcpy(replica, base, d * sizeof(float));
+    }
+    batch->sinceSync = 0;
+}
+
+/*
+ * The row is read again rather than taken from the batch, so concurrent
+ * updates by other threads since the gather are kept as far as possible.
+ **/
+void Train::addToRow(char *matrix, long long idx, const float *grad, float *scratch, myrandom &random) {
+    if (precision == PRECISION_FP32) {
+        simd.axpy(1.0f, grad, reinterpret_cast<float *>(row(matrix, idx)), n_hidden);
+        return;
+    }
+    loadRow(precision, row(matrix, idx), scratch, n_hidden);
+    simd.axpy(1.0f, grad, scratch, n_hidden);
+    storeRow(precision, scratch, row(matrix, idx), n_hidden, stochastic ? &random : nullptr);
 }
 
 void Train::trainSG() {
-    ull total_steps = n_walks * nv;
+    CorpusReader reader(this->corpus_path);
+    if (!reader.isOpen()) {
+        cout << "Cannot open walk corpus " << this->corpus_path << endl;
+        return;
+    }
+    long long block_num = reader.getBlockNum();
+    ull total_steps = (ull)reader.getHeader().walkNum * n_iter;
+
+    /* blocks trained so far in every iteration */
+    std::atomic<unsigned char> *blockDone = new std::atomic<unsigned char>[n_iter * block_num];
+    for (long long i = 0; i < n_iter * block_num; i++)
+        blockDone[i] = 0;
+    Checkpoint *checkpoint = nullptr;
+    if (this->checkpoint_path != nullptr) {
+        checkpoint = new Checkpoint(this->checkpoint_path);
+        CheckpointHeader header = this->checkpointHeader(block_num);
+        CheckpointHeader saved;
+        std::vector<unsigned char> done;
+        if (this->resume && checkpoint->load(header, saved, done, wVtx, wCtx)) {
+            long long doneNum = 0;
+            for (size_t i = 0; i < done.size(); i++) {
+                blockDone[i] = done[i];
+                doneNum += done[i];
+            }
+            this->step = saved.step;
+            this->pairs = saved.pairs;
+            this->resumedPairs = saved.pairs;
+            cout << "Resuming from " << this->checkpoint_path << ", " << doneNum << " of "
+                 << n_iter * block_num << " blocks trained" << endl;
+        }
+    }
+    auto lastCheckpoint = chrono::steady_clock::now();
+
+    /*
+     * Blocks hold the walks of consecutive start vertices, so threads
+     * taking them in order would hit the same hubs at the same time.
+     **/
+    std::vector<long long> blockOrder(block_num);
+    for (long long b = 0; b < block_num; b++)
+        blockOrder[b] = b;
+    myrandom shuffle(time(nullptr));
+    for (long long b = block_num - 1; b > 0; b--)
+        std::swap(blockOrder[b], blockOrder[shuffle.lrand() % (b + 1)]);
 
 #pragma omp parallel num_threads(threadNum)
 { 
-
     int tid = omp_get_thread_num();
+    myrandom random(time(nullptr) + tid); 
+    ull ncount = 0;
+    float lr = this->learningRate(step, total_steps);
+    WalkBlock *block = reader.newBlock();
+    std::vector<unsigned char> buffer;
+    Batch *batch = this->newBatch();
 
-if (files[tid] != nullptr)
-{
+    for (int it = 0; it < n_iter; it++) {
+#pragma omp for schedule(dynamic) nowait
+        for (long long i = 0; i < block_num; i++) {
+            long long b = blockOrder[i];
+            if (blockDone[it * block_num + b]) continue;
+            if (!reader.readBlock(b, block, buffer)) {
+#pragma omp critical
+                cout << "Skip corrupted corpus block " << b << endl;
+                blockDone[it * block_num + b] = 1;
+                continue;
+            }
+            int pos = 0;
+            for (int w = 0; w < block->walkNum; w++) {
+                int length = block->data[pos];
+                this->trainWalk(&block->data[pos + 1], length, lr, batch, random);
+                pos += length + 1;
+            }
+            ncount += block->walkNum;
+            blockDone[it * block_num + b] = 1;
 
-    myrandom random(time(nullptr)); 
-    const int trnd = random.irand(nv);
+            ull cur_step;
+#pragma omp atomic capture
+            { step += ncount; cur_step = step; }
+            ncount = 0;
+            lr = this->learningRate(cur_step, total_steps);
+            if (tid == 0)
+                cout << fixed << setprecision(6) << "\rlr " << lr << ", Progress "
+                     << setprecision(2) << cur_step * 100.f / (total_steps + 1) << "%";
+            if (tid == 0 && checkpoint != nullptr &&
+                chrono::steady_clock::now() - lastCheckpoint >= chrono::seconds(checkpointInterval) &&
+                checkpoint->start(this->checkpointHeader(block_num), blockDone, wVtx, wCtx))
+                lastCheckpoint = chrono::steady_clock::now();
+        }
+    }
+    delete block;
+    this->syncHubs(batch, random);
+    this->freeBatch(batch);
+} // omp parallel threads
+
+    if (checkpoint != nullptr) {
+        /* the final state, a resumed run then goes straight to the output */
+        checkpoint->wait();
+        checkpoint->start(this->checkpointHeader(block_num), blockDone, wVtx, wCtx);
+        delete checkpoint;
+    }
+    delete[] blockDone;
+}
+
+CheckpointHeader Train::checkpointHeader(long long blockNum) {
+    CheckpointHeader header;
+    initCheckpointHeader(header);
+    header.precision = precision;
+    header.vertexNum = nv;
+    header.dim = n_hidden;
+    header.rowBytes = rowBytes;
+    header.blockNum = blockNum;
+    header.iterNum = n_iter;
+    header.step = step;
+    header.pairs = pairs;
+    return header;
+}
+
+void Train::trainWalk(const int *walk, int length, float lr, Batch *batch, myrandom &random) {
+    if (this->visits != nullptr)
+        this->countVisits(walk, length);
+    if (this->affected != nullptr && !this->touchesAffected(walk, length))
+        return;
+    if (this->keepProb != nullptr) {
+        /* the window spans the vertices kept, like word2vec's sentences */
+        thread_local std::vector<int> kept;
+        kept.resize(length);
+        length = this->subsampleWalk(walk, length, kept.data(), random);
+        walk = kept.data();
+    }
+    ull walkPairs = 0;
+    for (int dwi = 0; dwi < length; dwi++) {
+        int b = random.irand(window_size); // subsample window size
+        long long n1 = walk[dwi];
+        if (n1 < 0)
+            break;
+        if (n1 >= nv) continue;
+
+        int inNum = 0;
+        for (int dwj = max(0, dwi - window_size + b);
+            dwj < min(dwi + window_size - b + 1, length); dwj++) {
+            if (dwi == dwj)
+                continue;
+            long long n2 = walk[dwj];
+            if (n2 < 0)
+                break;
+            if (n2 >= nv) continue;
+            batch->inIdx[inNum++] = n2;
+        }
+        if (inNum == 0) continue;
+
+        /* negatives shared by all contexts of this center */
+        int outNum = 0;
+        batch->outIdx[outNum++] = n1;
+        for (int d = 0; d < negative; d++) {
+            long long target = this->nextNegative(batch, 0, random);
+            if (target == n1)
+                continue;
+            batch->outIdx[outNum++] = target;
+        }
+        this->trainBatch(batch, inNum, outNum, lr, random);
+        walkPairs += inNum;
+    }
+#pragma omp atomic
+    this->pairs += walkPairs;
+}
+
+float Train::learningRate(ull curStep, ull totalSteps) {
+    float lr = initial_lr *
+        (1 - curStep / static_cast<float>(totalSteps + 1)); // linear LR decay
+    if (lr < initial_lr * 0.0001)
+        lr = initial_lr * 0.0001;
+    return lr;
+}
+
+void Train::trainStream() {
+    ull fallback_steps = (ull)n_walks * nv;
+
+#pragma omp parallel num_threads(threadNum)
+{
+    int tid = omp_get_thread_num();
+    myrandom random(time(nullptr) + tid);
     ull ncount = 0;
-    ull local_step = 0;
     float lr = initial_lr;
-    int *dw_rw = static_cast<int *>(
-        aligned_malloc(walk_length * sizeof(int),
-                       DEFAULT_ALIGN)); // we cache one random walk per thread
-    float *cache = static_cast<float *>(aligned_malloc(
-        n_hidden * sizeof(float),
-        DEFAULT_ALIGN)); // cache for updating the gradient of a node
+    Batch *batch = this->newBatch();
 
-#pragma omp barrier
-    int now_cnt = 0;
+    WalkBlock *block;
+    while ((block = this->queue->take()) != nullptr) {
+        int pos = 0;
+        for (int w = 0; w < block->walkNum; w++) {
+            int length = block->data[pos];
+            this->trainWalk(&block->data[pos + 1], length, lr, batch, random);
+            pos += length + 1;
+        }
+        ncount += block->walkNum;
+        this->queue->release(block);
 
-    while (fread(dw_rw, sizeof(int), walk_length, files[tid]) > 0) {
+        ull total_steps = this->queue->getExpectedWalks();
+        if (total_steps == 0)
+            total_steps = fallback_steps;
+        ull cur_step;
+#pragma omp atomic capture
+        { step += ncount; cur_step = step; }
+        ncount = 0;
+        lr = this->learningRate(cur_step, total_steps);
+        if (tid == 0)
+            cout << fixed << setprecision(6) << "\rlr " << lr << ", Progress "
+                 << setprecision(2) << cur_step * 100.f / (total_steps + 1) << "%";
+    }
+    this->syncHubs(batch, random);
+    this->freeBatch(batch);
+} // omp parallel threads
+}
 
-        if (ncount > 10) { // update progress every now and then
-#pragma omp atomic
-            step += ncount;
+void Train::bucketPairs() {
+    if (this->queue != nullptr) {
+#pragma omp parallel num_threads(threadNum)
+{
+        myrandom random(time(nullptr) + omp_get_thread_num());
+        PairBuckets::Writer writer(buckets);
+        WalkBlock *block;
+        while ((block = this->queue->take()) != nullptr) {
+            int pos = 0;
+            for (int w = 0; w < block->walkNum; w++) {
+                int length = block->data[pos];
+                this->bucketWalk(&block->data[pos + 1], length, writer, random);
+                pos += length + 1;
+            }
+            this->queue->release(block);
+        }
+} // omp parallel threads
+    } else {
+        CorpusReader reader(this->corpus_path);
+        if (!reader.isOpen()) {
+            cout << "Cannot open walk corpus " << this->corpus_path << endl;
+            return;
+        }
+        long long block_num = reader.getBlockNum();
+#pragma omp parallel num_threads(threadNum)
+{
+        myrandom random(time(nullptr) + omp_get_thread_num());
+        PairBuckets::Writer writer(buckets);
+        WalkBlock *block = reader.newBlock();
+        std::vector<unsigned char> buffer;
+#pragma omp for schedule(dynamic)
+        for (long long b = 0; b < block_num; b++) {
+            if (!reader.readBlock(b, block, buffer)) {
+#pragma omp critical
+                cout << "Skip corrupted corpus block " << b << endl;
+                continue;
+            }
+            int pos = 0;
+            for (int w = 0; w < block->walkNum; w++) {
+                int length = block->data[pos];
+                this->bucketWalk(&block->data[pos + 1], length, writer, random);
+                pos += length + 1;
+            }
+        }
+        delete block;
+} // omp parallel threads
+    }
+    cout << "Bucketed " << buckets->getPairs() << " pairs into "
+         << parts.partNum * parts.partNum << " buckets" << endl;
+    if (this->visits != nullptr) {
+        /* all walks are counted by now */
+        this->retiredNeg.push_back(this->negTable.exchange(this->buildNegTable(this->visits)));
+    }
+}
 
-            if (step > total_steps) // note than we may train for a little longer
-                break;
-            if (tid == 0 && step % 2 == 0)
-                cout << fixed << setprecision(6) << "\rlr " << lr << ", Progress "
-                     << setprecision(2) << step * 100.f / (total_steps + 1) << "%";
-            ncount = 0;
-            local_step = step;
-            lr =
-                initial_lr *
-                (1 - step / static_cast<float>(total_steps + 1)); // linear LR decay
-            if (lr < initial_lr * 0.0001)
-                lr = initial_lr * 0.0001;
-        }
-        for (int dwi = 0; dwi < walk_length; dwi++) {
-            int b = random.irand(window_size); // subsample window size
-            long long n1 = dw_rw[dwi];
-            if (n1 < 0)
+/*
+ * The windows of trainWalk in table rows, each one split into a record
+ * per context partition. Subsampling and window sizes are drawn once here, so they
+ * repeat over the iterations.
+ **/
+void Train::bucketWalk(const int *walk, int length, PairBuckets::Writer &writer, myrandom &random) {
+    if (this->visits != nullptr)
+        this->countVisits(walk, length);
+    if (this->affected != nullptr && !this->touchesAffected(walk, length))
+        return;
+    if (this->keepProb != nullptr) {
+        thread_local std::vector<int> kept;
+        kept.resize(length);
+        length = this->subsampleWalk(walk, length, kept.data(), random);
+        walk = kept.data();
+    }
+    thread_local std::vector<int> contexts;
+    contexts.resize(2 * window_size);
+    for (int dwi = 0; dwi < length; dwi++) {
+        int b = random.irand(window_size);
+        int n1 = walk[dwi];
+        if (n1 < 0)
+            break;
+        if (n1 >= nv) continue;
+
+        int num = 0;
+        for (int dwj = max(0, dwi - window_size + b);
+            dwj < min(dwi + window_size - b + 1, length); dwj++) {
+            if (dwi == dwj)
+                continue;
+            int n2 = walk[dwj];
+            if (n2 < 0)
                 break;
+            if (n2 >= nv) continue;
+            contexts[num++] = parts.slot[n2];
+        }
+        std::sort(contexts.begin(), contexts.begin() + num,
+            [this](int x, int y) { return parts.partOf(x) < parts.partOf(y); });
+        int center = parts.slot[n1];
+        for (int s = 0, e; s < num; s = e) {
+            int part = parts.partOf(contexts[s]);
+            for (e = s + 1; e < num && parts.partOf(contexts[e]) == part; e++);
+            writer.append(buckets->bucketOf(parts.partOf(center), part), center, &contexts[s], e - s);
+        }
+    }
+}
 
-            for (int dwj = max(0, dwi - window_size + b);
-                dwj < min(dwi + window_size - b + 1, walk_length); dwj++) {
-                if (dwi == dwj)
-                    continue;
-                long long n2 = dw_rw[dwi];
-                if (n2 < 0)
-                    break;
-                if (n1 > nv || n2 > nv) continue;
-                memset(cache, 0, n_hidden * sizeof(float)); // clear cache
-                update(&wCtx[n1 * n_hidden], &wVtx[n2 * n_hidden], cache, lr, 1);
-
-                AVX_LOOP
-                for (int c = 0; c < n_hidden; c++)
-                    wVtx[n2 * n_hidden + c] += cache[c];
+/*
+ * Each iteration makes `partPasses` passes over the buckets, a pass taking
+ * the next slice of every bucket, so that no partition goes stale while
+ * the others train. Within a pass buckets are visited row by row of center
+ * partitions, the rows in alternating direction so that the context
+ * partition carries over from one row to the next. A partition is evicted
+ * once the next bucket no longer uses it.
+ **/
+void Train::trainBuckets() {
+    int partNum = parts.partNum;
+    struct Visit { int pass, center, context; };
+    std::vector<Visit> order;
+    for (int it = 0; it < n_iter; it++) {
+        for (int pass = 0; pass < partPasses; pass++) {
+            for (int i = 0; i < partNum; i++) {
+                for (int jj = 0; jj < partNum; jj++)
+                    order.push_back({pass, i, i % 2 == 0 ? jj : partNum - 1 - jj});
             }
         }
-        ncount++; 
     }
-    free(dw_rw);
-    free(cache);
+    std::vector<long long> sizes(partNum * partNum);
+    for (int b = 0; b < partNum * partNum; b++)
+        sizes[b] = buckets->size(b);
+    ull total_steps = (ull)buckets->getPairs() * n_iter;
+    std::vector<int> chunk;
+    std::vector<long long> records;
+    bool more = false;
+    float lr = initial_lr;
+    ctxTable->load(order[0].center);
+    vtxTable->load(order[0].context);
+    this->hubPart = order[0].center;
 
-} // if file exist
+#pragma omp parallel num_threads(threadNum)
+{
+    int tid = omp_get_thread_num();
+    myrandom random(time(nullptr) + tid);
+    Batch *batch = this->newBatch();
 
+    for (size_t s = 0; s < order.size(); s++) {
+        Visit &cur = order[s];
+        int bucket = buckets->bucketOf(cur.center, cur.context);
+        if (s > 0 && cur.center != order[s - 1].center)
+            this->loadHubs(batch);
+        long long limit = sizes[bucket] * (cur.pass + 1) / partPasses;
+#pragma omp single
+        {
+            if (cur.pass == 0)
+                buckets->rewind(bucket);
+        }
+        while (true) {
+#pragma omp single
+            {
+                more = buckets->next(bucket, limit, chunk);
+                records.clear();
+                ull chunkPairs = 0;
+                for (size_t pos = 0; pos < chunk.size(); pos += 2 + chunk[pos + 1]) {
+                    records.push_back(pos);
+                    chunkPairs += chunk[pos + 1];
+                }
+                lr = this->learningRate(step, total_steps);
+                step += chunkPairs;
+                this->pairs += chunkPairs;
+                if (more)
+                    cout << fixed << setprecision(6) << "\rlr " << lr << ", Progress "
+                         << setprecision(2) << step * 100.f / (total_steps + 1) << "%" << flush;
+            }
+            if (!more) break;
+#pragma omp for schedule(dynamic, 256)
+            for (long long r = 0; r < (long long)records.size(); r++)
+                this->trainRecord(&chunk[records[r]], lr, batch, random);
+        }
+        /* every thread merges before the partitions of this bucket may be evicted */
+        this->syncHubs(batch, random);
+#pragma omp barrier
+#pragma omp single
+        {
+            bool last = s + 1 == order.size();
+            if (last || order[s + 1].center != cur.center) {
+                ctxTable->evict(cur.center);
+                if (!last) {
+                    ctxTable->load(order[s + 1].center);
+                    this->hubPart = order[s + 1].center;
+                }
+            }
+            if (last || order[s + 1].context != cur.context) {
+                vtxTable->evict(cur.context);
+                if (!last) vtxTable->load(order[s + 1].context);
+            }
+        }
+    }
+    this->freeBatch(batch);
 } // omp parallel threads
-    
+}
+
+void Train::trainRecord(const int *record, float lr, Batch *batch, myrandom &random) {
+    int n1 = record[0], inNum = record[1];
+    for (int i = 0; i < inNum; i++)
+        batch->inIdx[i] = record[2 + i];
+
+    int outNum = 0;
+    batch->outIdx[outNum++] = n1;
+    for (int d = 0; d < negative; d++) {
+        long long target = this->nextNegative(batch, parts.partOf(n1), random);
+        if (target == n1)
+            continue;
+        batch->outIdx[outNum++] = target;
+    }
+    this->trainBatch(batch, inNum, outNum, lr, random);
 }
 
 void Train::write_file() {
-    FILE *out_file = fopen(this->out_path, "w");
-    for (int i = 0; i < nv; i++) {
-        fprintf(out_file, "%d", i);
-        for (int j = 0; j < n_hidden; j++) {
-            fprintf(out_file, " %f", wCtx[i * n_hidden + j]);
+    ParallelFileWriter writer(this->out_path, false);
+    std::string header = this->outputHeader();
+    int64_t offset = header.size();
+    if (!writer.writeAt(0, header.data(), header.size())) {
+        printf("Cannot write %s\n", this->out_path);
+        exit(1);
+    }
+    std::vector<std::vector<char> > buffers(threadNum);
+    std::vector<int64_t> offsets(threadNum);
+    bool failed = false;
+    for (long long first = 0; first < nv; first += (long long)outputRows * threadNum) {
+#pragma omp parallel num_threads(threadNum)
+{
+        int tid = omp_get_thread_num();
+        thread_local std::vector<float> scratch;
+        scratch.resize(n_hidden);
+        long long begin = std::min(first + (long long)tid * outputRows, (long long)nv);
+        long long end = std::min(begin + outputRows, (long long)nv);
+        this->formatRows(begin, end, buffers[tid], scratch.data());
+#pragma omp barrier
+#pragma omp single
+        {
+            for (int t = 0; t < threadNum; t++) {
+                offsets[t] = offset;
+                offset += buffers[t].size();
+            }
         }
-        fprintf(out_file, "\n");
+        if (!buffers[tid].empty() && !writer.writeAt(offsets[tid], buffers[tid].data(), buffers[tid].size()))
+            failed = true;
+} // omp parallel threads
+        if (failed) {
+            printf("Cannot write %s\n", this->out_path);
+            exit(1);
+        }
+    }
+    writer.close(offset);
+}
+
+std::string Train::outputHeader() {
+    char line[64];
+    switch (format) {
+    case OUTPUT_BIN:
+        snprintf(line, sizeof(line), "%d %d %s\n", nv, n_hidden, precisionName(precision));
+        return line;
+    case OUTPUT_NPY:
+        return npyHeader(precision == PRECISION_FP16 ? "<f2" : "<f4", nv, n_hidden);
+    default:
+        snprintf(line, sizeof(line), "%d %d\n", nv, n_hidden);
+        return line;
+    }
+}
+
+/*
+ * Rows of vertices [first, last) appended to `out`, which is cleared
+ * first. Text and word2vec rows start with the vertex id.
+ **/
+void Train::formatRows(int first, int last, std::vector<char> &out, float *scratch) {
+    long long rowMax = 0;
+    switch (format) {
+    case OUTPUT_TXT: rowMax = 24 + (long long)n_hidden * (formatFloatBytes + 1); break;
+    case OUTPUT_W2V: rowMax = 24 + n_hidden * sizeof(float); break;
+    case OUTPUT_BIN: rowMax = dataBytes; break;
+    case OUTPUT_NPY: rowMax = precision == PRECISION_FP16 ? dataBytes : n_hidden * sizeof(float); break;
+    }
+    out.resize((long long)(last - first) * rowMax);
+    char *p = out.data();
+    for (int v = first; v < last; v++) {
+        const char *stored = row(wVtx, this->vertexRow(v));
+        if (format == OUTPUT_BIN || (format == OUTPUT_NPY && precision != PRECISION_BF16)) {
+            memcpy(p, stored, rowMax);
+            p += rowMax;
+            continue;
+        }
+        loadRow(precision, stored, scratch, n_hidden);
+        if (format == OUTPUT_NPY) {
+            memcpy(p, scratch, rowMax);
+            p += rowMax;
+            continue;
+        }
+        p += formatInt(v, p);
+        if (format == OUTPUT_W2V) {
+            *p++ = ' ';
+            memcpy(p, scratch, n_hidden * sizeof(float));
+            p += n_hidden * sizeof(float);
+        } else {
+            for (int j = 0; j < n_hidden; j++) {
+                *p++ = ' ';
+                p += formatFloat(scratch[j], p);
+            }
+        }
+        *p++ = '\n';
     }
-    fclose(out_file);
+    out.resize(p - out.data());
 }
 
 void Train::getArgs(int argc, char **argv) {
+    initial_lr = 0.025f;
+    window_size = 10;
+    negative = 5;
+    n_hidden = 128;
+    n_walks = 10;
+    n_iter = 1;
+    sample = 1e-3f;
+    this->out_path = nullptr;
+    const char *format_name = nullptr;
+    this->corpus_path = nullptr;
+    this->simd_name = nullptr;
+    this->precision = PRECISION_FP32;
+    this->stochastic = false;
+    this->padRows = false;
+    this->hubNum = 0;
+    this->hubSync = 1024;
+    this->negFromWalks = false;
+    this->checkpoint_path = nullptr;
+    this->checkpointInterval = 600;
+    this->resume = false;
+    this->init_emb_path = nullptr;
+    this->delta_path = nullptr;
+    this->parts.partNum = 1;
+    this->swap_dir = nullptr;
+    this->partPasses = 4;
+
     int a = 0;
     if ((a = argPos(const_cast<char *>("-threads"), argc, argv)) > 0)
         this->threadNum = atoi(argv[a + 1]);
     if ((a = argPos(const_cast<char *>("-walks"), argc, argv)) > 0)
         this->n_walks = atoi(argv[a + 1]);
-    if ((a = argPos(const_cast<char *>("-embout"), argc, argv)) > 0)
-        strcpy(this->out_path, argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-size"), argc, argv)) > 0)
+        this->n_hidden = atoi(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-window"), argc, argv)) > 0)
+        this->window_size = atoi(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-negative"), argc, argv)) > 0)
+        this->negative = atoi(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-alpha"), argc, argv)) > 0)
+        this->initial_lr = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-sample"), argc, argv)) > 0)
+        this->sample = atof(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-iter"), argc, argv)) > 0)
+        this->n_iter = atoi(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-output"), argc, argv)) > 0)
+        this->out_path = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-format"), argc, argv)) > 0)
+        format_name = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-corpus"), argc, argv)) > 0)
+        this->corpus_path = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-simd"), argc, argv)) > 0)
+        this->simd_name = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-precision"), argc, argv)) > 0) {
+        if (!parsePrecision(argv[a + 1], this->precision)) {
+            printf("Unknown precision %s, use fp32, bf16 or fp16\n", argv[a + 1]);
+            exit(1);
+        }
+    }
+    if ((a = argPos(const_cast<char *>("-stochastic-round"), argc, argv)) > 0)
+        this->stochastic = atoi(argv[a + 1]) != 0;
+    /* reduced precision tables are written as stored unless asked otherwise */
+    this->format = precision == PRECISION_FP32 ? OUTPUT_TXT : OUTPUT_BIN;
+    if (format_name != nullptr) {
+        if (strcmp(format_name, "txt") == 0) this->format = OUTPUT_TXT;
+        else if (strcmp(format_name, "bin") == 0) this->format = OUTPUT_BIN;
+        else if (strcmp(format_name, "npy") == 0) this->format = OUTPUT_NPY;
+        else if (strcmp(format_name, "w2v") == 0) this->format = OUTPUT_W2V;
+        else {
+            printf("Unknown output format %s, use txt, bin, npy or w2v\n", format_name);
+            exit(1);
+        }
+    }
+    if ((a = argPos(const_cast<char *>("-checkpoint"), argc, argv)) > 0)
+        this->checkpoint_path = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-checkpoint-interval"), argc, argv)) > 0)
+        this->checkpointInterval = std::max(1, atoi(argv[a + 1]));
+    if ((a = argPos(const_cast<char *>("-resume"), argc, argv)) > 0)
+        this->resume = atoi(argv[a + 1]) != 0;
+    if ((a = argPos(const_cast<char *>("-init-emb"), argc, argv)) > 0) {
+        this->init_emb_path = argv[a + 1];
+        /* fine-tuning starts slower so the previous space is kept */
+        if (argPos(const_cast<char *>("-alpha"), argc, argv) <= 0)
+            this->initial_lr /= 4;
+    }
+    if ((a = argPos(const_cast<char *>("-delta"), argc, argv)) > 0)
+        this->delta_path = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-neg-source"), argc, argv)) > 0) {
+        if (strcmp(argv[a + 1], "walks") == 0) this->negFromWalks = true;
+        else if (strcmp(argv[a + 1], "degree") != 0) {
+            printf("Unknown negative source %s, use degree or walks\n", argv[a + 1]);
+            exit(1);
+        }
+    }
+    if ((a = argPos(const_cast<char *>("-pad-rows"), argc, argv)) > 0)
+        this->padRows = atoi(argv[a + 1]) != 0;
+    if ((a = argPos(const_cast<char *>("-hub-replicas"), argc, argv)) > 0)
+        this->hubNum = atoi(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-hub-sync"), argc, argv)) > 0)
+        this->hubSync = std::max(1, atoi(argv[a + 1]));
+    if ((a = argPos(const_cast<char *>("-partitions"), argc, argv)) > 0)
+        this->parts.partNum = std::max(1, atoi(argv[a + 1]));
+    if ((a = argPos(const_cast<char *>("-partition-passes"), argc, argv)) > 0)
+        this->partPasses = std::max(1, atoi(argv[a + 1]));
+    if ((a = argPos(const_cast<char *>("-swap-dir"), argc, argv)) > 0)
+        this->swap_dir = argv[a + 1];
 }
 
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <vector>
 using namespace std;
 
 int sampleApp;
@@ -47,7 +48,7 @@ int argPos(char *str, int argc, char **argv) {
 
 myrandom::myrandom(uint64_t seed) {
     for (int i = 0; i < 2; i++) {
-    long long z = seed += UINT64_C(0x9E3779B97F4A7C15);
+    uint64_t z = seed += UINT64_C(0x9E3779B97F4A7C15);
     z = (z ^ z >> 30) * UINT64_C(0xBF58476D1CE4E5B9);
     z = (z ^ z >> 27) * UINT64_C(0x94D049BB133111EB);
     if (i == 0)
@@ -59,7 +60,7 @@ myrandom::myrandom(uint64_t seed) {
 
 void myrandom::reinit(uint64_t seed) {
     for (int i = 0; i < 2; i++) {
-        long long z = seed += UINT64_C(0x9E3779B97F4A7C15);
+        uint64_t z = seed += UINT64_C(0x9E3779B97F4A7C15);
         z = (z ^ z >> 30) * UINT64_C(0xBF58476D1CE4E5B9);
         z = (z ^ z >> 27) * UINT64_C(0x94D049BB133111EB);
         if (i == 0)
@@ -106,4 +107,29 @@ float fast_sigmoid(double x) {
 
 bool eq(float a, float b) {
     return abs(a - b) < 1e-4;
-}
\ No newline at end of file
+}
+
+void buildAliasTable(const float *weights, long long n, float *prob, int *alias) {
+    double sum = 0;
+    for (long long k = 0; k < n; k++) sum += weights[k];
+    std::vector<long long> small, large;
+    for (long long k = 0; k < n; k++) {
+        prob[k] = sum > 0 ? weights[k] * n / sum : 1.0f;
+        alias[k] = k;
+        if (prob[k] < 1.0f) small.push_back(k);
+        else large.push_back(k);
+    }
+    while (!small.empty() && !large.empty()) {
+        long long s = small.back(), l = large.back();
+        small.pop_back();
+        alias[s] = l;
+        prob[l] -= 1.0f - prob[s];
+        if (prob[l] < 1.0f) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    /* leftovers are 1 up to rounding */
+    for (long long k : small) prob[k] = 1.0f;
+    for (long long k : large) prob[k] = 1.0f;
+}
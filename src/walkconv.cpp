@@ -0,0 +1,118 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Export tool for compact walk corpora.
+ * Decodes blocks in parallel and writes them in file order either as text,
+ * one walk per line, or as raw int32 walks each prefixed by its length.
+ **/
+
+#include "corpus.h"
+#include "utils.h"
+
+#include <omp.h>
+#include <string>
+
+static int formatWalks(WalkBlock *block, std::vector<char> &out) {
+    out.resize((size_t)block->size * 11 + block->walkNum);
+    int bytes = 0;
+    int pos = 0;
+    for (int w = 0; w < block->walkNum; w++) {
+        int length = block->data[pos];
+        bytes += formatWalk(&block->data[pos + 1], length, out.data() + bytes);
+        pos += length + 1;
+    }
+    return bytes;
+}
+
+int main(int argc, char **argv) {
+    char *input = nullptr, *output = nullptr;
+    bool raw = false;
+    int threadNum = omp_get_max_threads();
+    int a = 0;
+    if ((a = argPos(const_cast<char *>("-input"), argc, argv)) > 0)
+        input = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-output"), argc, argv)) > 0)
+        output = argv[a + 1];
+    if ((a = argPos(const_cast<char *>("-threads"), argc, argv)) > 0)
+        threadNum = atoi(argv[a + 1]);
+    if ((a = argPos(const_cast<char *>("-format"), argc, argv)) > 0)
+        raw = !strcmp(argv[a + 1], "raw");
+    if (input == nullptr || output == nullptr) {
+        printf("Usage: walkconv -input <corpus> -output <file> [-format txt|raw] [-threads n]\n");
+        return 1;
+    }
+
+    CorpusReader reader(input);
+    if (!reader.isOpen()) {
+        printf("Cannot open corpus %s\n", input);
+        return 1;
+    }
+    CorpusHeader &header = reader.getHeader();
+    printf("%lld walks, %lld blocks, %lld vertices, walk length %d\n",
+           (long long)header.walkNum, (long long)header.blockNum,
+           (long long)header.vertexNum, header.walkLength);
+
+    FILE *out = fopen(output, "wb");
+    if (out == nullptr) {
+        printf("Cannot open %s\n", output);
+        return 1;
+    }
+
+    int batch = threadNum * 4;
+    std::vector<WalkBlock *> blocks(batch);
+    std::vector<std::vector<char> > texts(batch);
+    std::vector<int> bytes(batch);
+    std::vector<std::vector<unsigned char> > buffers(batch);
+    for (int i = 0; i < batch; i++)
+        blocks[i] = reader.newBlock();
+
+    int64_t blockNum = reader.getBlockNum();
+    for (int64_t first = 0; first < blockNum; first += batch) {
+        int count = (int)std::min<int64_t>(batch, blockNum - first);
+        bool ok = true;
+#pragma omp parallel for num_threads(threadNum) schedule(dynamic)
+        for (int i = 0; i < count; i++) {
+            if (!reader.readBlock(first + i, blocks[i], buffers[i])) {
+                ok = false;
+                continue;
+            }
+            if (!raw) bytes[i] = formatWalks(blocks[i], texts[i]);
+        }
+        if (!ok) {
+            printf("Corrupted corpus block near %lld\n", (long long)first);
+            return 1;
+        }
+        for (int i = 0; i < count; i++) {
+            if (raw)
+                fwrite(blocks[i]->data, sizeof(int), blocks[i]->size, out);
+            else
+                fwrite(texts[i].data(), 1, bytes[i], out);
+        }
+    }
+    fclose(out);
+    for (int i = 0; i < batch; i++)
+        delete blocks[i];
+    return 0;
+}
@@ -32,8 +32,7 @@ Walker::Walker(
         int     _initialVertex,
         State   _initialState,
         StartMode _startMode,
-        FILE    *file,
-        bool    _out,
+        WalkOutput *_output,
         SamplerManager  *_samplerManager,
         int     _burninIter) {
     this->randomWalkModel   = _model;
@@ -43,11 +42,12 @@ Walker::Walker(
     this->startMode         = _startMode;
     this->burninIter        = _burninIter;
     this->executable        = true;
+    this->length            = 0;
     //this->initialState      = this->randomWalkModel->getInitialState(
     //    this->initialVertex);
     this->initialState      = _initialState;
-    this->fp                = file;
-    this->out               = _out;
+    this->output            = _output;
+    this->tid               = omp_get_thread_num();
     this->samplerManager    = _samplerManager;
     if (initialState.first == -1) 
         this->executable = false;
@@ -79,18 +79,31 @@ void Walker::walkerExecute() {
     float w, w1;
     long long nextEdgeIdx;
     long long prevEdgeIdx;
-    long long curDegree;
-    long long curOffset;
+    VertexIndexType curDegree;
+    EdgeIndexType curOffset;
 
-    /* Main loop for walker execution */
-    for (int i = 1; i < this->walkLength; i++) {
+    /* Main loop for walker execution, a vertex without a state goes nowhere */
+    int i;
+    for (i = 1; i < this->walkLength && this->initialState.second >= 0; i++) {
         int vertex = this->curState.first;
         int index = this->curState.second;
 
-        curDegree = degrees[this->curVertex];
-        curOffset = offsets[this->curVertex];
+        WalkAction action = this->randomWalkModel->nextAction(this->curState, i, this->random);
+        if (action == WALK_STOP) break;
+        if (action == WALK_RESTART) {
+            this->curState = this->initialState;
+            this->curVertex = this->initialVertex;
+            this->walkSq[i] = this->curVertex;
+            continue;
+        }
+
+        this->randomWalkModel->candidateRange(this->curState, curOffset, curDegree);
 
-        nextEdgeIdx = curOffset + (long long)this->random.irand(curDegree);
+        /* no way out, the walk ends here */
+        if (curDegree == 0) break;
+
+        nextEdgeIdx = this->randomWalkModel->proposeEdge(
+            this->curState, curOffset, curDegree, this->random);
         nextEdgeIdx = this->samplerManager->getNextEdge(
             this->curState, nextEdgeIdx, this->startMode, random, this->samplerManager->memWeight);
 
@@ -102,14 +115,11 @@ void Walker::walkerExecute() {
 
     }
 
-    this->randomWalkModel->handleWalk(this->walkSq, this->walkLength);
+    this->length = i;
+    this->randomWalkModel->handleWalk(this->walkSq, this->length);
 
-    if (this->out) {
-        fwrite(this->walkSq, sizeof(int), this->walkLength, this->fp);
-        for (int i = 0; i < this->walkLength; i++) {
-            fprintf(this->fp, "%d ", this->walkSq[i]);
-        }
-        fprintf(this->fp, "\n");
+    if (this->output != nullptr) {
+        this->output->write(this->tid, this->walkSq, this->length);
     }
 }
 
@@ -0,0 +1,274 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "walkio.h"
+
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+ParallelFileWriter::ParallelFileWriter(const char *path, bool _direct) {
+    this->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (this->fd < 0) {
+        printf("Cannot open %s for writing\n", path);
+        exit(1);
+    }
+    this->directFd = this->fd;
+    this->direct = false;
+#ifdef O_DIRECT
+    if (_direct) {
+        this->directFd = open(path, O_WRONLY | O_DIRECT);
+        if (this->directFd >= 0) {
+            this->direct = true;
+        } else {
+            /* e.g. tmpfs does not support direct I/O */
+            printf("Direct I/O unavailable for %s, using buffered writes\n", path);
+            this->directFd = this->fd;
+        }
+    }
+#endif
+    this->end.store(0);
+}
+
+ParallelFileWriter::~ParallelFileWriter() {
+    if (this->fd >= 0) this->close(-1);
+}
+
+void *ParallelFileWriter::allocBuffer(size_t bytes) {
+    void *result;
+    if (posix_memalign(&result, alignment, padded(bytes)))
+        return nullptr;
+    return result;
+}
+
+bool ParallelFileWriter::writeAll(int file, const void *data, size_t bytes, int64_t offset) {
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0) {
+        ssize_t n = pwrite(file, p, bytes, offset);
+        if (n <= 0) {
+            perror("pwrite");
+            return false;
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool ParallelFileWriter::writeAt(int64_t offset, const void *data, size_t bytes) {
+    return this->writeAll(this->fd, data, bytes, offset);
+}
+
+int64_t ParallelFileWriter::reserve(size_t bytes) {
+    if (this->direct) bytes = padded(bytes);
+    return this->end.fetch_add(bytes);
+}
+
+int64_t ParallelFileWriter::append(void *data, size_t bytes, char fill) {
+    size_t length = bytes;
+    if (this->direct) {
+        length = padded(bytes);
+        memset(static_cast<char *>(data) + bytes, fill, length - bytes);
+    }
+    int64_t offset = this->end.fetch_add(length);
+    if (!this->writeAll(this->directFd, data, length, offset))
+        exit(1);
+    return offset;
+}
+
+void ParallelFileWriter::close(int64_t size) {
+    if (size >= 0 && ftruncate(this->fd, size) != 0)
+        perror("ftruncate");
+    if (this->directFd != this->fd)
+        ::close(this->directFd);
+    ::close(this->fd);
+    this->fd = -1;
+}
+
+int formatWalk(const int *walk, int length, char *out) {
+    char digits[12];
+    char *p = out;
+    for (int i = 0; i < length; i++) {
+        unsigned int v = walk[i];
+        int n = 0;
+        do { digits[n++] = '0' + v % 10; v /= 10; } while (v);
+        while (n) *p++ = digits[--n];
+        *p++ = ' ';
+    }
+    *p++ = '\n';
+    return p - out;
+}
+
+int formatInt(long long value, char *out) {
+    char digits[20];
+    char *p = out;
+    unsigned long long v = value;
+    if (value < 0) {
+        *p++ = '-';
+        v = -(unsigned long long)value;
+    }
+    int n = 0;
+    do { digits[n++] = '0' + v % 10; v /= 10; } while (v);
+    while (n) *p++ = digits[--n];
+    return p - out;
+}
+
+/*
+ * Fixed point through an integer of millionths. A float times 1e6 is
+ * exact in a double, so ties are seen and rounded to even like printf
+ * does. Signs and specials are read from the bits, which -Ofast keeps
+ * intact. Values of 1e12 and above, infinities and NaN go through
+ * snprintf.
+ **/
+int formatFloat(float value, char *out) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    double x = fabs(static_cast<double>(value));
+    if ((bits & 0x7F800000) == 0x7F800000 || x >= 1e12)
+        return snprintf(out, formatFloatBytes, "%f", value);
+    char *p = out;
+    if (bits >> 31)
+        *p++ = '-';
+    double y = x * 1e6;
+    unsigned long long scaled = static_cast<unsigned long long>(y);
+    double rest = y - scaled;
+    if (rest > 0.5 || (rest == 0.5 && (scaled & 1)))
+        scaled++;
+    p += formatInt(scaled / 1000000, p);
+    *p++ = '.';
+    unsigned int frac = scaled % 1000000;
+    for (int i = 5; i >= 0; i--) {
+        p[i] = '0' + frac % 10;
+        frac /= 10;
+    }
+    return p + 6 - out;
+}
+
+std::string npyHeader(const char *descr, long long rows, int cols) {
+    char shape[64];
+    snprintf(shape, sizeof(shape), "'shape': (%lld, %d), }", rows, cols);
+    std::string dict = std::string("{'descr': '") + descr + "', 'fortran_order': False, " + shape;
+    /* magic, version and length take 10 bytes, the dict ends with a newline */
+    size_t length = (10 + dict.size() + 1 + 63) / 64 * 64 - 10;
+    dict.resize(length - 1, ' ');
+    dict += '\n';
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(length & 0xFF);
+    header += static_cast<char>(length >> 8);
+    return header + dict;
+}
+
+TextWalkOutput::TextWalkOutput(const char *path, int _threadNum, int walkLength, bool direct) {
+    this->threadNum = _threadNum;
+    this->lineBytes = walkLength * 11 + 1;
+
+    /* create the parent directory, `txt` by default */
+    std::string prefix(path);
+    size_t slash = prefix.rfind('/');
+    if (slash != std::string::npos && slash > 0) {
+        prefix = prefix.substr(0, slash);
+        if (access(prefix.c_str(), 0) == -1)
+            mkdir(prefix.c_str(), S_IRWXU);
+    }
+    this->writer = new ParallelFileWriter(path, direct);
+
+    this->buffers = new Buffer[_threadNum];
+    for (int i = 0; i < _threadNum; i++) {
+        this->buffers[i].data = static_cast<char *>(
+            ParallelFileWriter::allocBuffer(bufferBytes + lineBytes));
+        this->buffers[i].bytes = 0;
+    }
+}
+
+TextWalkOutput::~TextWalkOutput() {
+    for (int i = 0; i < threadNum; i++)
+        free(this->buffers[i].data);
+    delete[] this->buffers;
+    delete this->writer;
+}
+
+void TextWalkOutput::write(int tid, const int *walk, int length) {
+    Buffer &buffer = this->buffers[tid];
+    buffer.bytes += formatWalk(walk, length, buffer.data + buffer.bytes);
+    if (buffer.bytes >= bufferBytes) {
+        /* padding of direct writes is harmless blank space for word2vec */
+        this->writer->append(buffer.data, buffer.bytes, ' ');
+        buffer.bytes = 0;
+    }
+}
+
+void TextWalkOutput::close() {
+    for (int i = 0; i < threadNum; i++) {
+        Buffer &buffer = this->buffers[i];
+        if (buffer.bytes == 0) continue;
+        this->writer->append(buffer.data, buffer.bytes, ' ');
+        buffer.bytes = 0;
+    }
+    this->writer->close(-1);
+}
+
+QueueWalkOutput::QueueWalkOutput(WalkQueue *_queue, int _threadNum) {
+    this->queue     = _queue;
+    this->threadNum = _threadNum;
+    this->pending   = static_cast<WalkBlock **>(
+        calloc(_threadNum, sizeof(WalkBlock *)));
+}
+
+QueueWalkOutput::~QueueWalkOutput() {
+    free(this->pending);
+}
+
+void QueueWalkOutput::write(int tid, const int *walk, int length) {
+    WalkBlock *&block = this->pending[tid];
+    if (block == nullptr)
+        block = this->queue->acquire();
+    if (!block->push(walk, length)) {
+        this->queue->submit(block);
+        block = this->queue->acquire();
+        if (!block->push(walk, length)) {
+            /* an empty block cannot hold it either, dropping it would go unnoticed */
+            printf("Walk of %d vertices does not fit a queue block of %d ints\n",
+                   length, this->queue->getBlockInts());
+            exit(1);
+        }
+    }
+}
+
+void QueueWalkOutput::close() {
+    for (int i = 0; i < threadNum; i++) {
+        if (this->pending[i] == nullptr) continue;
+        if (this->pending[i]->walkNum > 0)
+            this->queue->submit(this->pending[i]);
+        else
+            this->queue->release(this->pending[i]);
+        this->pending[i] = nullptr;
+    }
+    this->queue->close();
+}
@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "walkqueue.h"
+
+#include <string.h>
+#include <thread>
+
+WalkBlock::WalkBlock(int _capacity) {
+    this->capacity  = _capacity;
+    this->data      = static_cast<int *>(malloc(_capacity * sizeof(int)));
+    this->clear();
+}
+
+WalkBlock::~WalkBlock() {
+    free(this->data);
+}
+
+bool WalkBlock::push(const int *walk, int length) {
+    if (this->size + length + 1 > this->capacity) return false;
+    this->data[this->size] = length;
+    memcpy(&this->data[this->size + 1], walk, length * sizeof(int));
+    this->size += length + 1;
+    this->walkNum++;
+    return true;
+}
+
+BlockRing::BlockRing(int _capacity) {
+    size_t capacity = 2;
+    while (capacity < (size_t)_capacity) capacity <<= 1;
+    this->mask  = capacity - 1;
+    this->cells = new Cell[capacity];
+    for (size_t i = 0; i < capacity; i++)
+        this->cells[i].sequence.store(i, std::memory_order_relaxed);
+    this->head.store(0, std::memory_order_relaxed);
+    this->tail.store(0, std::memory_order_relaxed);
+}
+
+BlockRing::~BlockRing() {
+    delete[] this->cells;
+}
+
+bool BlockRing::push(WalkBlock *block) {
+    Cell *cell;
+    size_t pos = this->tail.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &this->cells[pos & this->mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (this->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;   /* full */
+        } else {
+            pos = this->tail.load(std::memory_order_relaxed);
+        }
+    }
+    cell->block = block;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool BlockRing::pop(WalkBlock *&block) {
+    Cell *cell;
+    size_t pos = this->head.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &this->cells[pos & this->mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (this->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;   /* empty */
+        } else {
+            pos = this->head.load(std::memory_order_relaxed);
+        }
+    }
+    block = cell->block;
+    cell->sequence.store(pos + this->mask + 1, std::memory_order_release);
+    return true;
+}
+
+WalkQueue::WalkQueue(int _blockNum, int _blockInts)
+    : filled(_blockNum), empty(_blockNum) {
+    this->blockNum  = _blockNum;
+    this->blockInts = _blockInts;
+    this->closed.store(false);
+    this->expectedWalks.store(0);
+    this->blocks = static_cast<WalkBlock **>(
+        malloc(_blockNum * sizeof(WalkBlock *)));
+    for (int i = 0; i < _blockNum; i++) {
+        this->blocks[i] = new WalkBlock(_blockInts);
+        this->empty.push(this->blocks[i]);
+    }
+}
+
+WalkQueue::~WalkQueue() {
+    for (int i = 0; i < this->blockNum; i++)
+        delete this->blocks[i];
+    free(this->blocks);
+}
+
+WalkBlock *WalkQueue::acquire() {
+    WalkBlock *block;
+    while (!this->empty.pop(block))
+        std::this_thread::yield();
+    return block;
+}
+
+void WalkQueue::submit(WalkBlock *block) {
+    while (!this->filled.push(block))
+        std::this_thread::yield();
+}
+
+void WalkQueue::close() {
+    this->closed.store(true, std::memory_order_release);
+}
+
+WalkBlock *WalkQueue::take() {
+    WalkBlock *block;
+    for (;;) {
+        if (this->filled.pop(block))
+            return block;
+        if (this->closed.load(std::memory_order_acquire)) {
+            /* a producer may have submitted right before closing */
+            if (this->filled.pop(block))
+                return block;
+            return nullptr;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void WalkQueue::release(WalkBlock *block) {
+    block->clear();
+    this->empty.push(block);
+}
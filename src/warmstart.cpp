@@ -0,0 +1,185 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+#include "warmstart.h"
+#include "checkpoint.h"
+#include "simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+PreviousEmbedding::PreviousEmbedding(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        printf("Cannot open %s\n", path);
+        exit(1);
+    }
+    char magic[8] = {0};
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    rewind(file);
+    if (got == sizeof(magic) && memcmp(magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0)
+        this->loadCheckpoint(file, path);
+    else if (got >= 6 && memcmp(magic, "\x93NUMPY", 6) == 0)
+        this->loadNpy(file, path);
+    else
+        this->loadText(file, path);
+    fclose(file);
+}
+
+void PreviousEmbedding::allocate(long long _vertexNum, int _dim) {
+    if (_vertexNum <= 0 || _dim <= 0) {
+        printf("Previous embedding has no rows\n");
+        exit(1);
+    }
+    this->vertexNum = _vertexNum;
+    this->dim = _dim;
+    this->vtx.resize(vertexNum * dim);
+    this->present.assign(vertexNum, 0);
+}
+
+/* the flags are skipped, both tables taken as they are */
+void PreviousEmbedding::loadCheckpoint(FILE *file, const char *path) {
+    CheckpointHeader header;
+    if (fread(&header, sizeof(CheckpointHeader), 1, file) != 1 ||
+        header.version != CHECKPOINT_VERSION) {
+        printf("%s is not a checkpoint\n", path);
+        exit(1);
+    }
+    this->allocate(header.vertexNum, header.dim);
+    this->ctx.resize(vertexNum * dim);
+    Precision precision = static_cast<Precision>(header.precision);
+    std::vector<char> row(header.rowBytes);
+    fseeko(file, sizeof(CheckpointHeader) + header.iterNum * header.blockNum, SEEK_SET);
+    for (int table = 0; table < 2; table++) {
+        float *dst = table == 0 ? vtx.data() : ctx.data();
+        for (long long v = 0; v <= vertexNum; v++) {
+            if (fread(row.data(), 1, row.size(), file) != row.size()) {
+                printf("Truncated checkpoint %s\n", path);
+                exit(1);
+            }
+            /* the spare row after the vertices is not needed */
+            if (v < vertexNum)
+                loadRow(precision, row.data(), dst + v * dim, dim);
+        }
+    }
+    this->present.assign(vertexNum, 1);
+}
+
+void PreviousEmbedding::loadNpy(FILE *file, const char *path) {
+    unsigned char preamble[10];
+    std::string dict;
+    long long rows = 0;
+    int cols = 0;
+    if (fread(preamble, 1, sizeof(preamble), file) == sizeof(preamble) && preamble[6] == 1) {
+        dict.resize(preamble[8] | (preamble[9] << 8));
+        if (fread(&dict[0], 1, dict.size(), file) != dict.size())
+            dict.clear();
+    }
+    size_t shape = dict.find("'shape': (");
+    bool fp16 = dict.find("'<f2'") != std::string::npos;
+    if (shape == std::string::npos || (!fp16 && dict.find("'<f4'") == std::string::npos) ||
+        dict.find("'fortran_order': False") == std::string::npos ||
+        sscanf(dict.c_str() + shape, "'shape': (%lld, %d)", &rows, &cols) != 2) {
+        printf("%s is not a 2D fp32 or fp16 NumPy array\n", path);
+        exit(1);
+    }
+    this->allocate(rows, cols);
+    Precision precision = fp16 ? PRECISION_FP16 : PRECISION_FP32;
+    std::vector<char> row((size_t)dim * precisionBytes(precision));
+    for (long long v = 0; v < vertexNum; v++) {
+        if (fread(row.data(), 1, row.size(), file) != row.size()) {
+            printf("Truncated embedding %s\n", path);
+            exit(1);
+        }
+        loadRow(precision, row.data(), vtx.data() + v * dim, dim);
+    }
+    this->present.assign(vertexNum, 1);
+}
+
+/*
+ * `txt` files are a `<vertices> <dimension>` line then one line per vertex,
+ * `bin` files a `<vertices> <dimension> <precision>` line then the rows.
+ * Text lines whose word is not a vertex id, such as word2vec's `</s>`,
+ * are skipped.
+ **/
+void PreviousEmbedding::loadText(FILE *file, const char *path) {
+    char first[128];
+    char name[16];
+    long long rows = 0;
+    int cols = 0;
+    int fields = fgets(first, sizeof(first), file) != nullptr
+        ? sscanf(first, "%lld %d %15s", &rows, &cols, name) : 0;
+    if (fields < 2) {
+        printf("%s is not an embedding file\n", path);
+        exit(1);
+    }
+    if (fields == 3) {
+        Precision precision;
+        if (!parsePrecision(name, precision)) {
+            printf("Unknown precision %s in %s\n", name, path);
+            exit(1);
+        }
+        this->allocate(rows, cols);
+        std::vector<char> row((size_t)dim * precisionBytes(precision));
+        for (long long v = 0; v < vertexNum; v++) {
+            if (fread(row.data(), 1, row.size(), file) != row.size()) {
+                printf("Truncated embedding %s\n", path);
+                exit(1);
+            }
+            loadRow(precision, row.data(), vtx.data() + v * dim, dim);
+        }
+        this->present.assign(vertexNum, 1);
+        return;
+    }
+
+    /* ids of text rows need not be dense, the largest one sets the size */
+    std::vector<long long> ids;
+    std::vector<float> values;
+    long long maxId = -1;
+    char *line = nullptr;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, file) > 0) {
+        char *end;
+        long long id = strtoll(line, &end, 10);
+        if (end == line || (*end != ' ' && *end != '\t') || id < 0) continue;
+        for (int c = 0; c < cols; c++) {
+            char *p = end;
+            values.push_back(strtof(p, &end));
+            if (end == p) {
+                printf("Row of vertex %lld in %s has fewer than %d values\n", id, path, cols);
+                exit(1);
+            }
+        }
+        maxId = std::max(maxId, id);
+        ids.push_back(id);
+    }
+    free(line);
+    this->allocate(maxId + 1, cols);
+    for (size_t i = 0; i < ids.size(); i++) {
+        memcpy(vtx.data() + ids[i] * dim, values.data() + i * dim, dim * sizeof(float));
+        present[ids[i]] = 1;
+    }
+}
@@ -43,28 +43,39 @@ long long vocab_max_size = 1000, vocab_size = 0, layer1_size = 128;
 long long train_words = 0, word_count_actual = 0, iter = 1, file_size = 0, classes = 0;
 real alpha = 0.025, starting_alpha, sample = 1e-3;
 real *syn0, *syn1, *syn1neg, *expTable;
+
+// "%f" of walkio.cpp, much faster than fprintf per value
+int formatFloat(float value, char *out);
+#define FORMAT_FLOAT_BYTES 48
 clock_t start;
 
 int hs = 0, negative = 5;
-const int table_size = 1e8;
-int *table;
+// Negatives come from an alias table over count^0.75, two entries per
+// word instead of a 1e8 entry table. buildAliasTable is in utils.cpp.
+float *table_prob;
+int *table_alias;
+void buildAliasTable(const float *weights, long long n, float *prob, int *alias);
 
 void InitUnigramTable() {
-  int a, i;
-  double train_words_pow = 0;
-  double d1, power = 0.75;
-  table = (int *)malloc(table_size * sizeof(int));
-  for (a = 0; a < vocab_size; a++) train_words_pow += pow(vocab[a].cn, power);
-  i = 0;
-  d1 = pow(vocab[i].cn, power) / train_words_pow;
-  for (a = 0; a < table_size; a++) {
-    table[a] = i;
-    if (a / (double)table_size > d1) {
-      i++;
-      d1 += pow(vocab[i].cn, power) / train_words_pow;
-    }
-    if (i >= vocab_size) i = vocab_size - 1;
-  }
+  long long a;
+  double power = 0.75;
+  float *weights = (float *)malloc(vocab_size * sizeof(float));
+  for (a = 0; a < vocab_size; a++) weights[a] = pow(vocab[a].cn, power);
+  table_prob = (float *)malloc(vocab_size * sizeof(float));
+  table_alias = (int *)malloc(vocab_size * sizeof(int));
+  buildAliasTable(weights, vocab_size, table_prob, table_alias);
+  free(weights);
+}
+
+// Two generator steps, the high bits of one pick the slot and those of
+// the other toss the coin
+long long SampleNegative(unsigned long long *next_random) {
+  long long slot;
+  *next_random = *next_random * (unsigned long long)25214903917 + 11;
+  slot = (*next_random >> 16) % vocab_size;
+  *next_random = *next_random * (unsigned long long)25214903917 + 11;
+  if (((*next_random >> 16) & 0xFFFFFF) < table_prob[slot] * 16777216.0f) return slot;
+  return table_alias[slot];
 }
 
 // Reads a single word from a file, assuming space + tab + EOL to be word boundaries
@@ -275,7 +286,7 @@ void LearnVocabFromTrainFile() {
   FILE *fin;
   long long a, i, wc = 0;
   for (a = 0; a < vocab_hash_size; a++) vocab_hash[a] = -1;
-  fin = fopen("txt/all", "rb");
+  fin = fopen(train_file, "rb");
   if (fin == NULL) {
     printf("ERROR: training data file not found!\n");
     exit(1);
@@ -339,7 +350,7 @@ void ReadVocab() {
     printf("Vocab size: %lld\n", vocab_size);
     printf("Words in train file: %lld\n", train_words);
   }
-  fin = fopen("txt/all", "rb");
+  fin = fopen(train_file, "rb");
   if (fin == NULL) {
     printf("ERROR: training data file not found!\n");
     exit(1);
@@ -383,7 +394,7 @@ void *TrainModelThread(void *id) {
   clock_t now;
   real *neu1 = (real *)calloc(layer1_size, sizeof(real));
   real *neu1e = (real *)calloc(layer1_size, sizeof(real));
-  FILE *fi = fopen("txt/all", "rb");
+  FILE *fi = fopen(train_file, "rb");
   fseek(fi, file_size / (long long)num_threads * (long long)id, SEEK_SET);
   while (1) {
     if (word_count - last_word_count > 10000) {
@@ -469,8 +480,7 @@ void *TrainModelThread(void *id) {
             target = word;
             label = 1;
           } else {
-            next_random = next_random * (unsigned long long)25214903917 + 11;
-            target = table[(next_random >> 16) % table_size];
+            target = SampleNegative(&next_random);
             if (target == 0) target = next_random % (vocab_size - 1) + 1;
             if (target == word) continue;
             label = 0;
@@ -525,8 +535,7 @@ void *TrainModelThread(void *id) {
             target = word;
             label = 1;
           } else {
-            next_random = next_random * (unsigned long long)25214903917 + 11;
-            target = table[(next_random >> 16) % table_size];
+            target = SampleNegative(&next_random);
             if (target == 0) target = next_random % (vocab_size - 1) + 1;
             if (target == word) continue;
             label = 0;
@@ -573,13 +582,23 @@ void TrainModel() {
   fo = fopen(output_file, "wb");
   if (classes == 0) {
     // Save the word vectors
+    char *line = (char *)malloc(layer1_size * (FORMAT_FLOAT_BYTES + 1) + 1);
     fprintf(fo, "%lld %lld\n", vocab_size, layer1_size);
     for (a = 0; a < vocab_size; a++) {
-      fprintf(fo, "%s", vocab[a].word);
-      if (binary) for (b = 0; b < layer1_size; b++) fwrite(&syn0[a * layer1_size + b], sizeof(real), 1, fo);
-      else for (b = 0; b < layer1_size; b++) fprintf(fo, " %lf", syn0[a * layer1_size + b]);
+      fprintf(fo, "%s ", vocab[a].word);
+      if (binary) fwrite(&syn0[a * layer1_size], sizeof(real), layer1_size, fo);
+      else {
+        // one write per vector, the leading space being written with the word
+        c = 0;
+        for (b = 0; b < layer1_size; b++) {
+          if (b) line[c++] = ' ';
+          c += formatFloat(syn0[a * layer1_size + b], line + c);
+        }
+        fwrite(line, 1, c, fo);
+      }
       fprintf(fo, "\n");
     }
+    free(line);
   } else {
     // Run K-means on the word vectors
     int clcn = classes, iter = 10, closeid;
@@ -686,15 +705,21 @@ void train_main(int argc, char **argv) {
     return 0;
   }
   */
+  strcpy(train_file, "txt/all");
   output_file[0] = 0;
   save_vocab_file[0] = 0;
   read_vocab_file[0] = 0;
   if ((i = ArgPos((char *)"-size", argc, argv)) > 0) layer1_size = atoi(argv[i + 1]);
   //if ((i = ArgPos((char *)"-train", argc, argv)) > 0) strcpy(train_file, argv[i + 1]);
+  if ((i = ArgPos((char *)"-walkfile", argc, argv)) > 0) strcpy(train_file, argv[i + 1]);
   //if ((i = ArgPos((char *)"-save-vocab", argc, argv)) > 0) strcpy(save_vocab_file, argv[i + 1]);
   //if ((i = ArgPos((char *)"-read-vocab", argc, argv)) > 0) strcpy(read_vocab_file, argv[i + 1]);
   //if ((i = ArgPos((char *)"-debug", argc, argv)) > 0) debug_mode = atoi(argv[i + 1]);
   if ((i = ArgPos((char *)"-binary", argc, argv)) > 0) binary = atoi(argv[i + 1]);
+  if ((i = ArgPos((char *)"-format", argc, argv)) > 0) {
+    if (!strcmp(argv[i + 1], "w2v")) binary = 1;
+    else if (strcmp(argv[i + 1], "txt")) printf("Format %s is not written by word2vec, using txt\n", argv[i + 1]);
+  }
   if ((i = ArgPos((char *)"-cbow", argc, argv)) > 0) cbow = atoi(argv[i + 1]);
   if (cbow) alpha = 0.05;
   if ((i = ArgPos((char *)"-alpha", argc, argv)) > 0) alpha = atof(argv[i + 1]);
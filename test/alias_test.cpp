@@ -0,0 +1,120 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Alias tables from buildAliasTable: the distribution a table encodes,
+ * and the one sampled from it, against the normalized weights.
+ **/
+#include "check.h"
+#include "../include/utils.h"
+
+#include <math.h>
+#include <vector>
+
+/* probability of every outcome, summed over the slots that yield it */
+static std::vector<double> tableDistribution(const std::vector<float> &prob, const std::vector<int> &alias) {
+    long long n = prob.size();
+    std::vector<double> p(n, 0.0);
+    for (long long k = 0; k < n; k++) {
+        p[k] += prob[k] / (double)n;
+        p[alias[k]] += (1.0 - prob[k]) / n;
+    }
+    return p;
+}
+
+static void checkTable(const std::vector<float> &weights) {
+    long long n = weights.size();
+    std::vector<float> prob(n);
+    std::vector<int> alias(n);
+    buildAliasTable(weights.data(), n, prob.data(), alias.data());
+
+    double sum = 0;
+    for (float w : weights) sum += w;
+    bool valid = true;
+    for (long long k = 0; k < n; k++)
+        valid &= prob[k] >= 0 && prob[k] <= 1 && alias[k] >= 0 && alias[k] < n;
+    CHECK(valid);
+    if (!valid) return;
+
+    std::vector<double> p = tableDistribution(prob, alias);
+    double worst = 0;
+    for (long long k = 0; k < n; k++) {
+        double expected = sum > 0 ? weights[k] / sum : 1.0 / n;
+        /* zero weights are never drawn, the others up to float rounding */
+        if (expected == 0)
+            CHECK(p[k] == 0);
+        else
+            worst = fmax(worst, fabs(p[k] - expected) / expected);
+    }
+    CHECK(worst < 1e-4);
+}
+
+/* draws as the trainer makes them, each count within six standard deviations */
+static void checkSampling(const std::vector<float> &weights, long long draws) {
+    int n = weights.size();
+    std::vector<float> prob(n);
+    std::vector<int> alias(n);
+    buildAliasTable(weights.data(), n, prob.data(), alias.data());
+    std::vector<long long> counts(n, 0);
+    myrandom random(5);
+    for (long long i = 0; i < draws; i++) {
+        int k = random.lrand() % n;
+        counts[random.drand() < prob[k] ? k : alias[k]]++;
+    }
+    double sum = 0;
+    for (float w : weights) sum += w;
+    int outside = 0;
+    for (int k = 0; k < n; k++) {
+        double p = weights[k] / sum;
+        outside += fabs(counts[k] - draws * p) > 6 * sqrt(draws * p * (1 - p)) + 1e-9;
+    }
+    CHECK(outside == 0);
+}
+
+int main() {
+    myrandom random(3);
+    checkTable(std::vector<float>(1, 2.0f));
+    checkTable(std::vector<float>(1000, 1.0f));
+    checkTable(std::vector<float>(1000, 0.0f));
+
+    /* degree like weights to the power 0.75, a few hubs and many leaves */
+    std::vector<float> skewed(1000000);
+    for (size_t k = 0; k < skewed.size(); k++)
+        skewed[k] = pow(1 + 100000.0 / (k + 1), 0.75);
+    checkTable(skewed);
+
+    std::vector<float> sparse(10000);
+    for (size_t k = 0; k < sparse.size(); k++)
+        sparse[k] = k % 3 == 0 ? 0.0f : random.drand() * 100;
+    checkTable(sparse);
+
+    std::vector<float> small = { 0.5f, 0.0f, 3.0f, 1.0f, 0.25f, 7.0f, 0.0f, 2.0f };
+    checkTable(small);
+    checkSampling(small, 4000000);
+    std::vector<float> power(50);
+    for (size_t k = 0; k < power.size(); k++)
+        power[k] = pow(k + 1, -1.5);
+    checkSampling(power, 4000000);
+    return checkResult("alias_test");
+}
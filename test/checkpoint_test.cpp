@@ -0,0 +1,191 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Checkpoints written by Checkpoint::start and read back by load, and the
+ * files load refuses. Refusals exit the process, so they run in a child.
+ **/
+#include "check.h"
+#include "../include/checkpoint.h"
+#include "../include/utils.h"
+
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static const int vertexNum = 1000, rowBytes = 64, blockNum = 7, iterNum = 3;
+
+static CheckpointHeader setup() {
+    CheckpointHeader header;
+    initCheckpointHeader(header);
+    header.precision = 1;
+    header.vertexNum = vertexNum;
+    header.dim = rowBytes / 2;
+    header.rowBytes = rowBytes;
+    header.blockNum = blockNum;
+    header.iterNum = iterNum;
+    return header;
+}
+
+struct Snapshot {
+    CheckpointHeader header;
+    std::vector<char> vtx, ctx;
+    std::vector<unsigned char> done;
+
+    Snapshot(myrandom &random, uint64_t step) : header(setup()) {
+        header.step = step;
+        header.pairs = step * 1000;
+        vtx.resize((vertexNum + 1) * rowBytes);
+        ctx.resize(vtx.size());
+        done.resize(blockNum * iterNum);
+        for (char &c : vtx) c = random.lrand();
+        for (char &c : ctx) c = random.lrand();
+        for (unsigned char &d : done) d = random.irand(2);
+    }
+
+    bool write(Checkpoint &checkpoint) {
+        std::vector<std::atomic<unsigned char> > flags(done.size());
+        for (size_t i = 0; i < done.size(); i++)
+            flags[i] = done[i];
+        bool started = checkpoint.start(header, flags.data(), vtx.data(), ctx.data());
+        checkpoint.wait();
+        return started;
+    }
+};
+
+static bool fileExists(const std::string &path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+/* output of snapshots and loads expected to fail goes to /dev/null */
+static int silence() {
+    fflush(stdout);
+    int saved = dup(1), null = open("/dev/null", O_WRONLY);
+    dup2(null, 1);
+    close(null);
+    return saved;
+}
+
+static void restore(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+/* exit status of a child process loading `path`, 0 if it was loaded */
+static int loadStatus(const std::string &path, const CheckpointHeader &expected) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        silence();
+        std::vector<char> vtx((expected.vertexNum + 1) * expected.rowBytes), ctx(vtx.size());
+        CheckpointHeader header;
+        std::vector<unsigned char> done;
+        Checkpoint checkpoint(path.c_str());
+        _exit(checkpoint.load(expected, header, done, vtx.data(), ctx.data()) ? 0 : 2);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+static void testRoundTrip(const std::string &path) {
+    myrandom random(9);
+    Checkpoint checkpoint(path.c_str());
+    CheckpointHeader expected = setup(), header;
+    std::vector<char> vtx((vertexNum + 1) * rowBytes), ctx(vtx.size());
+    std::vector<unsigned char> done;
+    CHECK(!checkpoint.load(expected, header, done, vtx.data(), ctx.data()));
+
+    /* each snapshot replaces the previous one */
+    for (uint64_t step = 1; step <= 3; step++) {
+        Snapshot snapshot(random, step);
+        CHECK(snapshot.write(checkpoint));
+        CHECK(!fileExists(path + ".tmp"));
+        CHECK(checkpoint.load(expected, header, done, vtx.data(), ctx.data()));
+        CHECK(header.step == step && header.pairs == step * 1000);
+        CHECK(done == snapshot.done);
+        CHECK(vtx == snapshot.vtx);
+        CHECK(ctx == snapshot.ctx);
+    }
+}
+
+static void testRefused(const std::string &path) {
+    CheckpointHeader expected = setup();
+    CHECK(loadStatus(path, expected) == 0);
+
+    /* every field of the setup must match */
+    CheckpointHeader other = expected;
+    other.vertexNum++;
+    CHECK(loadStatus(path, other) == 1);
+    other = expected;
+    other.dim++;
+    CHECK(loadStatus(path, other) == 1);
+    other = expected;
+    other.precision = 0;
+    CHECK(loadStatus(path, other) == 1);
+    other = expected;
+    other.blockNum--;
+    CHECK(loadStatus(path, other) == 1);
+    other = expected;
+    other.iterNum++;
+    CHECK(loadStatus(path, other) == 1);
+
+    /* a cut short file and another kind of file */
+    std::string cut = path + ".cut";
+    CHECK(system(("head -c 5000 " + path + " > " + cut).c_str()) == 0);
+    CHECK(loadStatus(cut, expected) == 1);
+    CHECK(system(("echo 'not a checkpoint at all' > " + cut).c_str()) == 0);
+    CHECK(loadStatus(cut, expected) == 1);
+    unlink(cut.c_str());
+}
+
+/* a snapshot that cannot be written leaves the checkpoint usable */
+static void testFailedWrite(const std::string &dir) {
+    myrandom random(10);
+    Checkpoint checkpoint((dir + "/missing/checkpoint").c_str());
+    Snapshot snapshot(random, 1);
+    int saved = silence();
+    bool first = snapshot.write(checkpoint), second = snapshot.write(checkpoint);
+    restore(saved);
+    CHECK(first && second);
+    CHECK(!fileExists(dir + "/missing/checkpoint.tmp"));
+}
+
+int main() {
+    char dir[] = "/tmp/uninet-test-XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        printf("Cannot create a directory in /tmp\n");
+        return 1;
+    }
+    std::string path = std::string(dir) + "/checkpoint";
+    testRoundTrip(path);
+    testRefused(path);
+    testFailedWrite(dir);
+    unlink(path.c_str());
+    rmdir(dir);
+    return checkResult("checkpoint_test");
+}
@@ -0,0 +1,177 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Round trips of walks through the corpus codec, and through a corpus file
+ * written by CorpusWalkOutput and read back by CorpusReader.
+ **/
+#include "check.h"
+#include "../include/corpus.h"
+#include "../include/utils.h"
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+typedef std::vector<int> Walk;
+
+static std::vector<Walk> randomWalks(myrandom &random, int num, int vertexNum) {
+    std::vector<Walk> walks(num);
+    for (int w = 0; w < num; w++) {
+        /* length 1 walks come from isolated vertices */
+        int length = w % 7 == 0 ? 1 : 1 + random.irand(80);
+        for (int i = 0; i < length; i++)
+            walks[w].push_back(random.irand(vertexNum));
+    }
+    return walks;
+}
+
+/* walks of a decoded block, in the length prefixed layout of WalkBlock */
+static std::vector<Walk> blockWalks(WalkBlock *block) {
+    std::vector<Walk> walks;
+    for (int i = 0; i < block->size; i += block->data[i] + 1)
+        walks.push_back(Walk(block->data + i + 1, block->data + i + 1 + block->data[i]));
+    return walks;
+}
+
+static void checkCodec(CorpusCodec &codec, const std::vector<Walk> &walks) {
+    std::vector<unsigned char> encoded;
+    int ints = 0;
+    for (const Walk &walk : walks) {
+        size_t end = encoded.size();
+        encoded.resize(end + CorpusCodec::maxBytes(walk.size()));
+        int bytes = codec.encodeWalk(walk.data(), walk.size(), encoded.data() + end);
+        CHECK(bytes <= CorpusCodec::maxBytes(walk.size()));
+        encoded.resize(end + bytes);
+        ints += walk.size() + 1;
+    }
+    WalkBlock block(ints);
+    CHECK(codec.decodeBlock(encoded.data(), encoded.size(), walks.size(), &block));
+    CHECK(block.walkNum == (int)walks.size());
+    CHECK(block.size == ints);
+    CHECK(blockWalks(&block) == walks);
+
+    /* truncated input and a block too small are reported, not overrun */
+    CHECK(!codec.decodeBlock(encoded.data(), encoded.size() - 1, walks.size(), &block));
+    WalkBlock small(ints - 1);
+    CHECK(!codec.decodeBlock(encoded.data(), encoded.size(), walks.size(), &small));
+}
+
+static void testDelta() {
+    myrandom random(1);
+    CorpusCodec codec(CORPUS_DELTA, INT_MAX);
+    std::vector<Walk> walks = randomWalks(random, 2000, INT_MAX);
+    /* the largest differences between vertex ids */
+    walks.push_back(Walk{0, INT_MAX, 0, INT_MAX - 1, 1});
+    checkCodec(codec, walks);
+}
+
+static void testRank() {
+    myrandom random(2);
+    const int vertexNum = 100000;
+    std::vector<int> degrees(vertexNum);
+    for (int v = 0; v < vertexNum; v++)
+        degrees[v] = random.irand(50);
+    CorpusCodec codec(CORPUS_RANK, vertexNum);
+    codec.buildRank(degrees.data());
+    VertexIndexType *rank = codec.getRankTable();
+    for (int r = 1; r < vertexNum; r++)
+        CHECK(degrees[rank[r - 1]] >= degrees[rank[r]]);
+    checkCodec(codec, randomWalks(random, 2000, vertexNum));
+
+    /* vertices added later are ranked after the existing ones */
+    CorpusCodec extended(CORPUS_RANK, vertexNum);
+    extended.buildRank(degrees.data());
+    extended.extend(vertexNum + 10);
+    CHECK(extended.getRankTable()[vertexNum + 3] == vertexNum + 3);
+    int added[2] = { vertexNum + 3, vertexNum + 9 };
+    unsigned char out[16];
+    int bytes = extended.encodeWalk(added, 2, out);
+    WalkBlock block(3);
+    CHECK(extended.decodeBlock(out, bytes, 1, &block));
+    CHECK(blockWalks(&block) == std::vector<Walk>(1, Walk(added, added + 2)));
+    /* and corrupt input to a codec without them */
+    CHECK(!codec.decodeBlock(out, bytes, 1, &block));
+}
+
+static void testFile(CorpusEncoding encoding) {
+    myrandom random(3);
+    const int vertexNum = 5000, threadNum = 3;
+    std::vector<int> degrees(vertexNum);
+    for (int v = 0; v < vertexNum; v++)
+        degrees[v] = random.irand(20);
+    CorpusCodec codec(encoding, vertexNum);
+    if (encoding == CORPUS_RANK)
+        codec.buildRank(degrees.data());
+
+    char path[] = "/tmp/uninet-test-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    /* enough walks for several blocks per thread */
+    std::vector<Walk> walks = randomWalks(random, 60000, vertexNum);
+    CorpusHeader header;
+    initCorpusHeader(header, encoding, vertexNum);
+    header.walkLength = 80;
+    {
+        CorpusWalkOutput output(path, header, &codec, threadNum, false);
+        for (size_t w = 0; w < walks.size(); w++)
+            output.write(w % threadNum, walks[w].data(), walks[w].size());
+        output.close();
+    }
+    CHECK(corpusComplete(path));
+
+    CorpusReader reader(path);
+    CHECK(reader.isOpen());
+    CHECK(reader.getHeader().walkNum == (int64_t)walks.size());
+    CHECK(reader.getHeader().encoding == encoding);
+    CHECK(reader.getBlockNum() > threadNum);
+    std::vector<Walk> read;
+    std::vector<unsigned char> buffer;
+    WalkBlock *block = reader.newBlock();
+    for (int64_t b = 0; b < reader.getBlockNum(); b++) {
+        CHECK(reader.getBlockEntry(b).firstWalk == (int64_t)read.size());
+        CHECK(reader.readBlock(b, block, buffer));
+        std::vector<Walk> got = blockWalks(block);
+        read.insert(read.end(), got.begin(), got.end());
+    }
+    delete block;
+    unlink(path);
+
+    /* blocks of different threads interleave, the walks themselves do not change */
+    std::sort(walks.begin(), walks.end());
+    std::sort(read.begin(), read.end());
+    CHECK(read == walks);
+}
+
+int main() {
+    testDelta();
+    testRank();
+    testFile(CORPUS_DELTA);
+    testFile(CORPUS_RANK);
+    return checkResult("corpus_test");
+}
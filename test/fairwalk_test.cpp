@@ -0,0 +1,148 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Next step distributions of Fairwalk and node2vec from one state, sampled
+ * through the M-H samplers the walkers use. Fairwalk gives every neighbor
+ * type the same share and applies node2vec's p and q bias within it.
+ **/
+#include "check.h"
+#include "../include/kgraph.h"
+#include "../include/sampler.h"
+#include "../include/models/fairwalk.h"
+#include "../include/models/node2vec.h"
+
+#include <math.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/*
+ * The walk came from `PREV` (1) to `CUR` (0). Neighbors of CUR:
+ *   type 1: PREV, ADJ1 (adjacent to PREV), FAR1 (two steps from PREV)
+ *   type 2: ADJ2 (adjacent to PREV), FAR2 and FAR3
+ *   type 3: FAR4
+ **/
+enum { CUR, PREV, ADJ1, FAR1, ADJ2, FAR2, FAR3, FAR4, VERTEX_NUM };
+
+static std::string writeGraph() {
+    std::vector<std::vector<int> > neighbors = {
+        { PREV, ADJ1, FAR1, ADJ2, FAR2, FAR3, FAR4 },
+        { CUR, ADJ1, ADJ2 },
+        { CUR, PREV }, { CUR }, { CUR, PREV }, { CUR }, { CUR }, { CUR }
+    };
+    std::vector<int> types = { 1, 1, 1, 1, 2, 2, 2, 3 };
+    std::vector<long long> offsets;
+    std::vector<int> edges;
+    for (auto &list : neighbors) {
+        offsets.push_back(edges.size());
+        edges.insert(edges.end(), list.begin(), list.end());
+    }
+    char path[] = "/tmp/uninet-test-XXXXXX";
+    int fd = mkstemp(path);
+    FILE *file = fdopen(fd, "wb");
+    long long nv = VERTEX_NUM, ne = edges.size();
+    fwrite(&nv, sizeof(nv), 1, file);
+    fwrite(&ne, sizeof(ne), 1, file);
+    fwrite(offsets.data(), sizeof(long long), nv, file);
+    fwrite(edges.data(), sizeof(int), ne, file);
+    fwrite(types.data(), sizeof(int), nv, file);
+    fclose(file);
+    return path;
+}
+
+/* share of every next vertex over `steps` samples from (CUR, PREV) */
+static std::vector<double> stepDistribution(RWModel *model, LSGraph *graph, int steps) {
+    SamplerManager manager(model, graph);
+    myrandom random(13);
+    State state(CUR, graph->find_edge(CUR, PREV) - graph->getOffsets()[CUR]);
+    EdgeIndexType begin;
+    VertexIndexType count;
+    model->candidateRange(state, begin, count);
+    std::vector<double> share(VERTEX_NUM, 0.0);
+    for (int i = 0; i < steps; i++) {
+        EdgeIndexType candidate = model->proposeEdge(state, begin, count, random);
+        EdgeIndexType next = manager.getNextEdge(state, candidate, RANDOM, random, manager.memWeight);
+        share[graph->getEdges()[next]] += 1.0 / steps;
+    }
+    return share;
+}
+
+static bool near(double value, double expected) {
+    return fabs(value - expected) <= 0.05 * expected;
+}
+
+static std::vector<double> sampleFairwalk(LSGraph *graph, const char *p, const char *q) {
+    char *argv[] = { const_cast<char *>("test"), const_cast<char *>("-p"), const_cast<char *>(p),
+                     const_cast<char *>("-q"), const_cast<char *>(q) };
+    RWModel *model = (RWModel *)new Fairwalk(graph, 5, argv);
+    std::vector<double> share = stepDistribution(model, graph, 2000000);
+    delete model;
+    return share;
+}
+
+static std::vector<double> sampleNode2vec(LSGraph *graph, const char *p, const char *q) {
+    char *argv[] = { const_cast<char *>("test"), const_cast<char *>("-p"), const_cast<char *>(p),
+                     const_cast<char *>("-q"), const_cast<char *>(q) };
+    RWModel *model = (RWModel *)new Node2vec(graph, 5, argv);
+    std::vector<double> share = stepDistribution(model, graph, 2000000);
+    delete model;
+    return share;
+}
+
+int main() {
+    std::string path = writeGraph();
+    char *argv[] = { const_cast<char *>("test"), const_cast<char *>("-input"),
+                     const_cast<char *>(path.c_str()), const_cast<char *>("-hetro") };
+    LSGraph graph;
+    graph.loadCRSGraph(4, argv);
+    unlink(path.c_str());
+
+    /* without a bias, a third per type and uniform within a type */
+    std::vector<double> share = sampleFairwalk(&graph, "1", "1");
+    CHECK(near(share[PREV] + share[ADJ1] + share[FAR1], 1.0 / 3));
+    CHECK(near(share[ADJ2] + share[FAR2] + share[FAR3], 1.0 / 3));
+    CHECK(near(share[FAR4], 1.0 / 3));
+    for (int v : { PREV, ADJ1, FAR1, ADJ2, FAR2, FAR3 })
+        CHECK(near(share[v], 1.0 / 9));
+
+    /*
+     * q moves a neighbor of PREV against a vertex two steps away by a
+     * factor q in both models, p moves going back by 1 / p
+     **/
+    const char *qs[] = { "2", "0.5" };
+    for (const char *q : qs) {
+        std::vector<double> fair = sampleFairwalk(&graph, "1", q);
+        std::vector<double> node = sampleNode2vec(&graph, "1", q);
+        CHECK(near(fair[ADJ1] / fair[FAR1], atof(q)));
+        CHECK(near(fair[ADJ2] / fair[FAR2], atof(q)));
+        CHECK(near(node[ADJ1] / node[FAR1], atof(q)));
+        CHECK(near(node[ADJ2] / node[FAR2], atof(q)));
+    }
+    std::vector<double> fair = sampleFairwalk(&graph, "0.5", "1");
+    std::vector<double> node = sampleNode2vec(&graph, "0.5", "1");
+    CHECK(near(fair[PREV] / fair[ADJ1], 2));
+    CHECK(near(node[PREV] / node[ADJ1], 2));
+    return checkResult("fairwalk_test");
+}
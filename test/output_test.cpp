@@ -0,0 +1,112 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Embedding output formatting: formatFloat against "%f" and the NPY header.
+ **/
+#include "check.h"
+#include "../include/walkio.h"
+#include "../include/utils.h"
+
+#include <string.h>
+#include <string>
+
+static float floatOf(uint32_t bits) {
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/* counts the values formatted unlike snprintf, printing the first ones */
+static int mismatches = 0;
+
+static void compare(float value) {
+    char expected[formatFloatBytes], got[formatFloatBytes + 1];
+    int length = snprintf(expected, sizeof(expected), "%f", value);
+    int n = formatFloat(value, got);
+    got[n] = 0;
+    if (n != length || strcmp(expected, got) != 0) {
+        if (mismatches++ < 10)
+            printf("formatFloat(%a) gave \"%s\" instead of \"%s\"\n", value, got, expected);
+    }
+}
+
+static void testFormatFloat() {
+    myrandom random(11);
+    /* any sign and mantissa, magnitudes between 2^-30 and 2^50 */
+    for (int i = 0; i < 2000000; i++) {
+        uint32_t bits = random.lrand();
+        uint32_t exp = 127 - 30 + (bits >> 8) % 81;
+        compare(floatOf((bits & 0x807FFFFF) | exp << 23));
+    }
+    /* odd multiples of 2^-7 lie halfway between two sixth decimals */
+    for (int m = 1; m < 200000; m += 2) {
+        compare(m / 128.0f);
+        compare(-m / 128.0f);
+    }
+    compare(0.0f);
+    compare(floatOf(0x80000000));
+    compare(floatOf(0x00000001));
+    compare(floatOf(0x80000001));
+    compare(0.0000005f);
+    compare(-0.0000005f);
+    compare(999999.9999995f);
+    compare(floatOf(0x5368D4A4));   /* largest float below 1e12 */
+    compare(1e12f);
+    compare(floatOf(0x7F7FFFFF));
+    compare(floatOf(0x7F800000));
+    compare(floatOf(0xFF800000));
+    compare(floatOf(0x7FC00000));
+    CHECK(mismatches == 0);
+}
+
+static void checkNpyHeader(const char *descr, long long rows, int cols) {
+    std::string header = npyHeader(descr, rows, cols);
+    CHECK(header.size() % 64 == 0);
+    CHECK(header.compare(0, 8, std::string("\x93NUMPY\x01\x00", 8)) == 0);
+    size_t length = (unsigned char)header[8] | (unsigned char)header[9] << 8;
+    CHECK(length + 10 == header.size());
+    CHECK(header.back() == '\n');
+
+    char dict[128];
+    snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%lld, %d), }",
+             descr, rows, cols);
+    CHECK(header.compare(10, strlen(dict), dict) == 0);
+    /* padded with spaces up to the newline */
+    CHECK(header.find_first_not_of(' ', 10 + strlen(dict)) == header.size() - 1);
+}
+
+static void testNpyHeader() {
+    checkNpyHeader("<f4", 10312, 128);
+    checkNpyHeader("<f2", 10312, 128);
+    checkNpyHeader("<f4", 0, 1);
+    checkNpyHeader("<f2", 2147483647, 65536);
+    checkNpyHeader("<f4", 123456789012345LL, 100000);
+}
+
+int main() {
+    testFormatFloat();
+    testNpyHeader();
+    return checkResult("output_test");
+}
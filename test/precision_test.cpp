@@ -0,0 +1,197 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020, Beijing University of Posts and Telecommunications.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+
+/*
+ * Conversions between fp32 and the bf16 and fp16 storage formats, checked
+ * against values decoded from the bit fields: every stored value loads
+ * exactly, rounding to nearest sends ties to even, and stochastic rounding
+ * is unbiased. Rows of one value take the scalar code, longer rows the
+ * vector code when the CPU has it.
+ **/
+#include "check.h"
+#include "../include/simd.h"
+#include "../include/utils.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static uint32_t bitsOf(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static float floatOf(uint32_t bits) {
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+static const uint16_t signBit = 0x8000;
+
+static uint16_t infCode(Precision precision) {
+    return precision == PRECISION_BF16 ? 0x7F80 : 0x7C00;
+}
+
+/* magnitude of a finite code, or of the next power of two past the largest */
+static double codeValue(Precision precision, uint16_t code) {
+    int mantBits = precision == PRECISION_BF16 ? 7 : 10;
+    int bias = precision == PRECISION_BF16 ? 127 : 15;
+    int exp = (code & 0x7FFF) >> mantBits;
+    int mant = code & ((1 << mantBits) - 1);
+    if (exp == 0)
+        return ldexp(mant, 1 - bias - mantBits);
+    return ldexp((1 << mantBits) + mant, exp - bias - mantBits);
+}
+
+/*
+ * Positive codes checked, leaving out NaNs and the bf16 subnormals, which
+ * -Ofast flushes to zero in fp32 arithmetic.
+ **/
+static bool checked(Precision precision, uint16_t code) {
+    if (code >= infCode(precision)) return code == infCode(precision);
+    return precision != PRECISION_BF16 || code == 0 || code >= 0x80;
+}
+
+static void store(Precision precision, const std::vector<float> &in, std::vector<uint16_t> &out,
+                  bool scalar, myrandom *random) {
+    out.resize(in.size());
+    if (!scalar) {
+        storeRow(precision, in.data(), out.data(), in.size(), random);
+        return;
+    }
+    for (size_t i = 0; i < in.size(); i++)
+        storeRow(precision, &in[i], &out[i], 1, random);
+}
+
+static void testLoad(Precision precision, bool scalar) {
+    std::vector<uint16_t> codes;
+    std::vector<uint32_t> expected;
+    for (uint32_t c = 0; c < 0x8000; c++) {
+        if (!checked(precision, c)) continue;
+        for (int sign = 0; sign <= signBit; sign += signBit) {
+            codes.push_back(c | sign);
+            uint32_t bits = c == infCode(precision) ? 0x7F800000 : bitsOf(codeValue(precision, c));
+            expected.push_back(bits | (uint32_t)sign << 16);
+        }
+    }
+    std::vector<float> loaded(codes.size());
+    if (scalar) {
+        for (size_t i = 0; i < codes.size(); i++)
+            loadRow(precision, &codes[i], &loaded[i], 1);
+    } else {
+        loadRow(precision, codes.data(), loaded.data(), codes.size());
+    }
+    int wrong = 0;
+    for (size_t i = 0; i < codes.size(); i++)
+        wrong += bitsOf(loaded[i]) != expected[i];
+    CHECK(wrong == 0);
+
+    /* and they are stored back unchanged */
+    std::vector<uint16_t> stored;
+    store(precision, loaded, stored, scalar, nullptr);
+    CHECK(stored == codes);
+}
+
+/*
+ * Around the midpoint of every pair of neighbouring codes, the largest
+ * finite code and infinity included: the midpoint goes to the even code,
+ * the floats next to it to the nearer one.
+ **/
+static void testNearest(Precision precision, bool scalar) {
+    std::vector<float> in;
+    std::vector<uint16_t> expected;
+    for (uint32_t c = 0; c < infCode(precision); c++) {
+        if (!checked(precision, c) || !checked(precision, c + 1)) continue;
+        uint32_t mid = bitsOf((codeValue(precision, c) + codeValue(precision, c + 1)) / 2);
+        uint16_t even = c & 1 ? c + 1 : c;
+        for (int sign = 0; sign <= signBit; sign += signBit) {
+            uint32_t s = (uint32_t)sign << 16;
+            in.push_back(floatOf(mid | s));
+            expected.push_back(even | sign);
+            in.push_back(floatOf((mid - 1) | s));
+            expected.push_back(c | sign);
+            in.push_back(floatOf((mid + 1) | s));
+            expected.push_back((c + 1) | sign);
+        }
+    }
+    std::vector<uint16_t> out;
+    store(precision, in, out, scalar, nullptr);
+    int wrong = 0;
+    for (size_t i = 0; i < in.size(); i++)
+        wrong += out[i] != expected[i];
+    CHECK(wrong == 0);
+}
+
+/*
+ * The mean of many stochastic roundings of a value between two codes is
+ * the value itself, within ten standard deviations.
+ **/
+static void testStochastic(Precision precision, bool scalar) {
+    myrandom random(7);
+    const int num = scalar ? 1 << 16 : 1 << 18;
+    float values[] = { 0.0123f, 0.3f, 1.7f, -2.9f, 37.5f, -611.0f };
+    float fractions[] = { 0.125f, 0.5f, 0.75f };
+    for (float value : values) {
+        std::vector<float> in(1, value);
+        std::vector<uint16_t> out;
+        store(precision, in, out, true, nullptr);
+        uint16_t code = out[0] & 0x7FFF, sign = out[0] & signBit;
+        double lo = codeValue(precision, code), hi = codeValue(precision, code + 1);
+        for (float fraction : fractions) {
+            float x = (lo + fraction * (hi - lo)) * (sign ? -1 : 1);
+            in.assign(num, x);
+            store(precision, in, out, scalar, &random);
+            double sum = 0;
+            bool neighbours = true;
+            for (uint16_t h : out) {
+                neighbours &= h == (code | sign) || h == ((code + 1) | sign);
+                sum += (h & 0x7FFF) == code ? lo : hi;
+            }
+            CHECK(neighbours);
+            double sigma = sqrt(fraction * (1 - fraction) / num);
+            CHECK(fabs(sum / num - fabs(x)) <= 10 * sigma * (hi - lo));
+        }
+        /* representable values are kept */
+        in.assign(num, floatOf(bitsOf(lo) | (sign ? 0x80000000 : 0)));
+        store(precision, in, out, scalar, &random);
+        int wrong = 0;
+        for (uint16_t h : out)
+            wrong += h != (code | sign);
+        CHECK(wrong == 0);
+    }
+}
+
+int main() {
+    Precision precisions[] = { PRECISION_BF16, PRECISION_FP16 };
+    for (Precision precision : precisions) {
+        for (int scalar = 0; scalar <= 1; scalar++) {
+            testLoad(precision, scalar);
+            testNearest(precision, scalar);
+            testStochastic(precision, scalar);
+        }
+    }
+    return checkResult("precision_test");
+}